@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+/**
+ * @brief Counting replacements for the global operator new and delete
+ *
+ * Every heap allocation made through operator new, by any thread, increments
+ * a global counter, so a region of code can be checked for allocations with
+ * AllocationScope. With glibc, the bytes currently allocated are tracked as
+ * well, for measuring the memory held by a data structure. The replacement
+ * operators are not inline (the language forbids it), so this header must be
+ * included by exactly one translation unit of a program.
+ */
+namespace alloc_counter {
+	inline std::atomic<size_t> allocations{0};
+	inline std::atomic<size_t> live_bytes{0}; // Zero unless using glibc
+
+	inline void* counted(void* p) {
+		if (!p)
+			throw std::bad_alloc();
+		allocations.fetch_add(1, std::memory_order_relaxed);
+#ifdef __GLIBC__
+		live_bytes.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+#endif
+		return p;
+	}
+
+	inline void* allocate(size_t n) { return counted(std::malloc(n ? n : 1)); }
+
+	inline void* allocate_aligned(size_t n, size_t align) {
+		// aligned_alloc requires the size to be a multiple of the alignment
+		return counted(std::aligned_alloc(align, (n + align - 1) / align * align));
+	}
+
+	inline void release(void* p) {
+#ifdef __GLIBC__
+		if (p)
+			live_bytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+#endif
+		std::free(p);
+	}
+}
+
+/**
+ * @brief Counts heap allocations made while it exists
+ *
+ * Counts are process-wide, so other threads allocating during the scope are
+ * included.
+ */
+class AllocationScope {
+public:
+	AllocationScope() : start(alloc_counter::allocations.load()) { }
+
+	/**
+	 * @brief Get number of allocations since the scope began
+	 *
+	 * @return size_t Allocation count
+	 */
+	size_t count() const { return alloc_counter::allocations.load() - start; }
+private:
+	size_t start;
+};
+
+void* operator new (size_t n) { return alloc_counter::allocate(n); }
+void* operator new[] (size_t n) { return alloc_counter::allocate(n); }
+void* operator new (size_t n, std::align_val_t a)
+	{ return alloc_counter::allocate_aligned(n, (size_t) a); }
+void* operator new[] (size_t n, std::align_val_t a)
+	{ return alloc_counter::allocate_aligned(n, (size_t) a); }
+void operator delete (void* p) noexcept { alloc_counter::release(p); }
+void operator delete[] (void* p) noexcept { alloc_counter::release(p); }
+void operator delete (void* p, size_t) noexcept { alloc_counter::release(p); }
+void operator delete[] (void* p, size_t) noexcept { alloc_counter::release(p); }
+void operator delete (void* p, std::align_val_t) noexcept { alloc_counter::release(p); }
+void operator delete[] (void* p, std::align_val_t) noexcept { alloc_counter::release(p); }
+void operator delete (void* p, size_t, std::align_val_t) noexcept { alloc_counter::release(p); }
+void operator delete[] (void* p, size_t, std::align_val_t) noexcept { alloc_counter::release(p); }
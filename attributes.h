@@ -0,0 +1,148 @@
+#pragma once
+
+#include "frozen_graph.h"
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+/**
+ * @brief A contiguous array holding one attribute for every vertex or edge
+ *
+ * @tparam V Data type of the attribute
+ *
+ * Element i belongs to vertex i or edge i of a FrozenGraph. Keeping each
+ * attribute in its own array means a pass over one attribute reads only
+ * that attribute, in order, which compilers can vectorize.
+ */
+template <typename V>
+class Column {
+public:
+	Column(size_t n, const V& init) : values(n, init) { }
+
+	V& operator[] (size_t i) { return values[i]; }
+	const V& operator[] (size_t i) const { return values[i]; }
+	V* data() { return values.data(); }
+	const V* data() const { return values.data(); }
+	typename std::vector<V>::iterator begin() { return values.begin(); }
+	typename std::vector<V>::iterator end() { return values.end(); }
+	typename std::vector<V>::const_iterator begin() const { return values.begin(); }
+	typename std::vector<V>::const_iterator end() const { return values.end(); }
+	size_t size() const { return values.size(); }
+
+private:
+	std::vector<V> values;
+};
+
+/**
+ * @brief Named, typed vertex and edge attributes for a frozen graph
+ *
+ * @tparam T Data type of vertices
+ *
+ * Attributes are stored as one Column per name, in structure-of-arrays
+ * form, indexed by the vertex and edge numbers of the graph. The graph must
+ * outlive the attributes.
+ */
+template <typename T>
+class GraphAttributes {
+public:
+	explicit GraphAttributes(const FrozenGraph<T>& g) : g(g) { }
+
+	/**
+	 * @brief Get a vertex attribute, creating it if needed
+	 *
+	 * @tparam V Data type of the attribute
+	 * @param name Name of the attribute
+	 * @param init Value given to every vertex if the attribute is created
+	 * @return Column<V>& One value per vertex
+	 * @throw std::bad_cast The attribute exists with a different type
+	 */
+	template <typename V>
+	Column<V>& vertex_column(const std::string& name, const V& init = V())
+		{ return column<V>(vertex_columns, name, g.vertex_count(), init); }
+
+	/**
+	 * @brief Get an edge attribute, creating it if needed
+	 *
+	 * @tparam V Data type of the attribute
+	 * @param name Name of the attribute
+	 * @param init Value given to every edge if the attribute is created
+	 * @return Column<V>& One value per edge
+	 * @throw std::bad_cast The attribute exists with a different type
+	 */
+	template <typename V>
+	Column<V>& edge_column(const std::string& name, const V& init = V())
+		{ return column<V>(edge_columns, name, g.edge_count(), init); }
+
+	/**
+	 * @brief Get an attribute of one vertex
+	 *
+	 * @param col A vertex column
+	 * @param v The vertex of interest
+	 * @return V& The vertex's value
+	 * @throw std::out_of_range Vertex v does not exist
+	 */
+	template <typename V>
+	V& of_vertex(Column<V>& col, const T& v) const {
+		size_t i = g.index_of(v);
+		if (i == FrozenGraph<T>::npos)
+			throw std::out_of_range("GraphAttributes::of_vertex");
+		return col[i];
+	}
+
+	/**
+	 * @brief Get an attribute of one edge
+	 *
+	 * @param col An edge column
+	 * @param v1 Vertex at which edge begins
+	 * @param v2 Vertex at which edge ends
+	 * @return V& The edge's value
+	 * @throw std::out_of_range There is no edge from v1 to v2
+	 */
+	template <typename V>
+	V& of_edge(Column<V>& col, const T& v1, const T& v2) const {
+		size_t i = g.index_of(v1), j = g.index_of(v2);
+		size_t k = i != FrozenGraph<T>::npos && j != FrozenGraph<T>::npos
+			? g.find_edge(i, j) : FrozenGraph<T>::npos;
+		if (k == FrozenGraph<T>::npos)
+			throw std::out_of_range("GraphAttributes::of_edge");
+		return col[k];
+	}
+
+	/**
+	 * @brief Remove an attribute
+	 *
+	 * @param name Name of the vertex or edge attribute
+	 */
+	void erase(const std::string& name) {
+		vertex_columns.erase(name);
+		edge_columns.erase(name);
+	}
+
+private:
+	// Type-erased holder so columns of different types share one map
+	struct AnyColumn {
+		virtual ~AnyColumn() = default;
+	};
+	template <typename V>
+	struct TypedColumn : AnyColumn {
+		TypedColumn(size_t n, const V& init) : col(n, init) { }
+		Column<V> col;
+	};
+
+	const FrozenGraph<T>& g;
+	std::map<std::string, std::unique_ptr<AnyColumn> > vertex_columns;
+	std::map<std::string, std::unique_ptr<AnyColumn> > edge_columns;
+
+	template <typename V>
+	static Column<V>& column(std::map<std::string, std::unique_ptr<AnyColumn> >& m,
+		const std::string& name, size_t n, const V& init) {
+		std::unique_ptr<AnyColumn>& p = m[name];
+		if (!p)
+			p.reset(new TypedColumn<V>(n, init));
+		return dynamic_cast<TypedColumn<V>&>(*p).col;
+	}
+};
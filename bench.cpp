@@ -0,0 +1,832 @@
+// Benchmarks for graph operations
+#include "alloc_counter.h"
+#include "attributes.h"
+#include "delta_log.h"
+#include "euler.h"
+#include "euler_cache.h"
+#include "frozen_graph.h"
+#include "graph.h"
+#include "partition.h"
+#include "perf_counters.h"
+#include "scheduler.h"
+#include "shard_service.h"
+#include "small_graph.h"
+#include "temporal_graph.h"
+#include "trail_writer.h"
+#include "traversal.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+using namespace std;
+
+Graph<int> random_graph (int n, int m, unsigned seed);
+Graph<int> torus_graph (int side);
+DiGraph<int> rmat_graph (int scale, int m, unsigned seed);
+template <typename F>
+void measure (const string& name, size_t edges, F f);
+template <typename F>
+void check_no_alloc (const string& name, F f);
+
+bool use_perf = false;    // Read hardware counters around each region
+PerfCounters* counters;   // The one set of counters, when use_perf
+bool check_alloc = false; // Fail if allocation-free operations allocate
+bool failed = false;      // Some check failed
+
+/**
+ * @brief Build the first sample graph from euler.cpp
+ *
+ * @tparam G Graph type, which must have add_edge(int, int)
+ * @return G The graph, which has an Euler circuit
+ */
+template <typename G>
+constexpr G sample_graph () {
+	G g;
+	const int edges[][2] = { { 1, 2 }, { 1, 3 }, { 1, 4 }, { 1, 5 }, { 2, 3 },
+		{ 2, 5 }, { 2, 6 }, { 3, 6 }, { 3, 7 }, { 4, 5 }, { 5, 6 }, { 6, 7 } };
+	for (const auto& e : edges)
+		g.add_edge(e[0], e[1]);
+	return g;
+}
+
+int main (int argc, char* argv[]) {
+	int n = 100000; // Vertex count
+	int d = 8;      // Average degree
+	size_t pf = 8;  // Prefetch distance for traversals
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--perf"))
+			use_perf = true;
+		else if (!strcmp(argv[i], "--check-alloc"))
+			check_alloc = true;
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			n = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-d") && i + 1 < argc)
+			d = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+			pf = atoi(argv[++i]);
+		else {
+			cerr << "usage: " << argv[0] << " [-n vertices] [-d degree] [-p prefetch] [--perf] [--check-alloc]\n";
+			return 1;
+		}
+	}
+	int m = n / 2 * d; // Undirected edges, each stored in both directions
+	size_t e = 2 * (size_t) m;
+	// Counters are inherited only by threads started after they are opened,
+	// so open them before anything starts the scheduler's workers
+	unique_ptr<PerfCounters> perf;
+	if (use_perf) {
+		perf.reset(new PerfCounters);
+		counters = perf.get();
+		cout << "Hardware counters sum over all threads, so parallel regions\n"
+			"include every worker, busy or idle\n\n";
+	}
+	cout << "Graph: " << n << " vertices, " << m << " edges\n\n";
+
+	Graph<int> g;
+	size_t live_before = alloc_counter::live_bytes;
+	measure("build", e, [&] { g = random_graph(n, m, 1); });
+	size_t graph_bytes = alloc_counter::live_bytes - live_before;
+	if (graph_bytes)
+		cout << "    " << graph_bytes / e << " bytes/edge held by graph\n";
+
+	long sum = 0; // Keeps the optimizer from discarding traversals
+	measure("neighbor scan", e, [&] {
+		for (int v : g.vertices())
+			for (int u : g.neighbors(v))
+				sum += u;
+	});
+
+	auto view_scan = [&] {
+		for (int v : g.vertex_view())
+			for (int u : g.neighbor_view(v))
+				sum += u;
+	};
+	measure("neighbor view", e, view_scan);
+
+	// Every edge with its weight, as an export pass would read them
+	long nested_sum = 0, range_sum = 0;
+	vector<long> edge_sums(n + 1);
+	measure("edge lookups", e, [&] {
+		for (int v : g.vertices())
+			for (int u : g.neighbors(v))
+				nested_sum += (long) g.weight(v, u) * u - v;
+	});
+	auto edge_scan = [&] {
+		for (auto [v1, v2, w] : g.edge_view())
+			range_sum += (long) w * v2 - v1;
+	};
+	measure("edge view", e, edge_scan);
+	measure("parallel edges", e, [&] {
+		// A vertex's edges all go to one task, so each sum has one writer
+		parallel_for_edges(g, [&](int v1, int v2, size_t w) { edge_sums[v1] += (long) w * v2 - v1; });
+	});
+	if (range_sum != nested_sum || accumulate(edge_sums.begin(), edge_sums.end(), 0L) != nested_sum) {
+		cout << "FAIL: edge view differs from edge lookups\n";
+		failed = true;
+	}
+
+	mt19937 rng(2);
+	uniform_int_distribution<int> pick(1, n);
+	auto probe = [&] {
+		for (size_t i = 0; i < e; i++)
+			sum += g.is_edge(pick(rng), pick(rng));
+	};
+	measure("is_edge", e, probe);
+	measure("weight", e, [&] {
+		for (size_t i = 0; i < e; i++)
+			sum += g.weight(pick(rng), pick(rng));
+	});
+
+	// The same probes made one at a time and as one batch
+	vector<pair<int, int> > batch_probes(e);
+	mt19937 brng(2);
+	for (auto& q : batch_probes)
+		q = { pick(brng), pick(brng) };
+	vector<bool> batch_found;
+	size_t single_found = 0;
+	measure("probe loop", e, [&] {
+		for (const auto& q : batch_probes)
+			single_found += g.is_edge(q.first, q.second);
+	});
+	measure("batched is_edge", e, [&] { batch_found = g.is_edge(batch_probes); });
+	vector<size_t> batch_weights = g.weight(batch_probes);
+	bool batch_ok = (size_t) count(batch_found.begin(), batch_found.end(), true) == single_found;
+	for (size_t i = 0; i < e && batch_ok; i += 97)
+		batch_ok = batch_found[i] == g.is_edge(batch_probes[i].first, batch_probes[i].second)
+			&& batch_weights[i] == g.weight(batch_probes[i].first, batch_probes[i].second);
+	if (!batch_ok) {
+		cout << "FAIL: batched probes differ from single probes\n";
+		failed = true;
+	}
+
+	// The same probes, nearly all of missing edges, behind an edge filter
+	{
+		Graph<int> filtered(g);
+		measure("build edge filter", e, [&] { filtered.enable_edge_filter(); });
+		size_t filtered_found = 0;
+		measure("filtered probe loop", e, [&] {
+			for (const auto& q : batch_probes)
+				filtered_found += filtered.is_edge(q.first, q.second);
+		});
+		measure("filtered batch", e, [&] { batch_found = filtered.is_edge(batch_probes); });
+		bool filter_ok = filtered_found == single_found
+			&& (size_t) count(batch_found.begin(), batch_found.end(), true) == single_found;
+
+		// Every edge must still be found after edges come and go
+		mt19937 frng(4);
+		for (size_t i = 0; i < e / 4; i++) {
+			int a = pick(frng), b = pick(frng);
+			NeighborView<int> nb = filtered.neighbor_view(a);
+			if (!nb.empty()) {
+				int u = *nb.begin(); // Copied, since removal shifts the adjacency
+				filtered.remove_edge(a, u);
+			}
+			filtered.add_edge(a, b, 2);
+		}
+		for (int v : filtered.vertex_view())
+			for (int u : filtered.neighbor_view(v))
+				filter_ok = filter_ok && filtered.is_edge(v, u);
+		cout << setw(20) << "edge filter" << ": " << filtered.edge_filter().bytes() / 1024
+			<< " KB, " << filtered.edge_filter().size() << " edges\n";
+		if (!filter_ok) {
+			cout << "FAIL: edge filter changed an answer\n";
+			failed = true;
+		}
+	}
+
+	measure("copy", e, [&] { Graph<int> g_copy(g); sum += g_copy.degree(1); });
+	Graph<int> g_clone;
+	measure("parallel clone", e, [&] { g_clone = g.clone(); });
+	if (g_clone.fingerprint() != g.fingerprint()) {
+		cout << "FAIL: clone differs from graph\n";
+		failed = true;
+	}
+
+	// A replica kept up to date from the log of changes to the original
+	{
+		Graph<int> changed(g), replica(g);
+		DeltaLog<int> log;
+		changed.set_listener(&log);
+		mt19937 drng(3);
+		for (int i = 0; i < m / 100; i++) {
+			int v1 = pick(drng), v2 = pick(drng);
+			if (i % 3 == 0)
+				changed.remove_edge(v1, v2);
+			else
+				changed.update_edge(v1, v2, i);
+		}
+		for (int i = 0; i < 10; i++)
+			changed.remove(pick(drng));
+		changed.set_listener(nullptr);
+		cout << "    " << log.count() << " changes logged in " << log.size() << " bytes\n";
+		measure("delta replay", log.count(), [&] { log.replay(replica); });
+		DeltaLog<int> d;
+		measure("diff", e, [&] { diff<int>(g, changed, d); });
+		Graph<int> from_diff(g);
+		DeltaLog<int> full;
+		diff<int>(DiGraph<int>(), g, full);
+		cout << "    diff " << d.size() << " bytes, whole graph " << full.size() << " bytes\n";
+		if (!d.replay(from_diff) || replica.fingerprint() != changed.fingerprint()
+				|| from_diff.fingerprint() != changed.fingerprint()) {
+			cout << "FAIL: replayed delta differs from changed graph\n";
+			failed = true;
+		}
+	}
+
+	// The graph served by shard processes over Unix domain sockets; the
+	// coordinator's answers must match the local graph's
+	{
+		LocalShards shards(g, 4);
+		ShardClient client(shards.paths());
+		cout << "\nSharded (" << client.shard_count() << " processes):\n";
+		vector<pair<int, int> > probes(e / 10);
+		mt19937 srng(4);
+		for (auto& q : probes)
+			q = { pick(srng), pick(srng) };
+		vector<bool> remote_edges;
+		measure("batched is_edge", probes.size(), [&] { remote_edges = client.is_edge(probes); });
+		map<int, size_t> remote_dist, local_dist;
+		measure("distributed bfs", e, [&] { remote_dist = client.bfs(1); });
+		vector<int> frontier(1, 1), next;
+		local_dist[1] = 0;
+		for (size_t level = 1; !frontier.empty(); level++, frontier.swap(next)) {
+			next.clear();
+			for (int v : frontier)
+				for (int u : g.neighbor_view(v))
+					if (local_dist.emplace(u, level).second)
+						next.push_back(u);
+		}
+		bool edges_match = true;
+		for (size_t i = 0; i < probes.size(); i++)
+			edges_match = edges_match
+				&& remote_edges[i] == g.is_edge(probes[i].first, probes[i].second);
+		LocalShards torus_shards(torus_graph(150), 4);
+		if (!edges_match || remote_dist != local_dist
+				|| !ShardClient(torus_shards.paths()).has_euler_path()) {
+			cout << "FAIL: sharded answers differ from the local graph\n";
+			failed = true;
+		}
+	}
+
+	// Splitting the graph for placement on shards: by hash, streamed in one
+	// pass, and multilevel
+	{
+		const size_t k = 8;
+		cout << "\nPartition into " << k << " parts:\n";
+		map<int, size_t> by_hash, ldg, fennel, multilevel;
+		for (int v : g.vertex_view())
+			by_hash[v] = shard::owner(v, k);
+		measure("ldg", e, [&] {
+			ldg = partition_streaming(g, k, StreamingPartitioner::Method::LDG);
+		});
+		measure("fennel", e, [&] { fennel = partition_streaming(g, k); });
+		measure("multilevel", e, [&] { multilevel = partition_multilevel(g, k); });
+		const pair<const char*, const map<int, size_t>*> results[] = {
+			{ "hash", &by_hash }, { "ldg", &ldg }, { "fennel", &fennel },
+			{ "multilevel", &multilevel } };
+		for (const auto& r : results) {
+			PartitionQuality q = evaluate(g, *r.second, k);
+			cout << "    " << left << setw(12) << r.first << right << setw(8)
+				<< q.edge_cut << " edges cut, balance " << setprecision(3) << q.balance << "\n";
+		}
+		PartitionQuality ml = evaluate(g, multilevel, k);
+		if (ml.edge_cut >= evaluate(g, by_hash, k).edge_cut || ml.balance > 1.031) {
+			cout << "FAIL: multilevel partition is no better than hashing\n";
+			failed = true;
+		}
+	}
+
+	// Euler circuits across shard processes, placed by hash and by the
+	// multilevel partitioner; cut edges become trail ends to be joined
+	{
+		Graph<int> torus = torus_graph(150);
+		size_t torus_edges = 2 * 150 * 150;
+		cout << "\nDistributed Euler (4 processes):\n";
+		auto is_circuit = [&](const vector<int>& p) {
+			set<pair<int, int> > seen;
+			for (size_t i = 0; i + 1 < p.size(); i++)
+				if (!torus.is_edge(p[i], p[i + 1])
+						|| !seen.insert(minmax(p[i], p[i + 1])).second)
+					return false;
+			return p.size() == torus_edges + 1 && p.front() == p.back();
+		};
+		const pair<const char*, map<int, size_t> > placements[] = {
+			{ "hash", map<int, size_t>() },
+			{ "multilevel", partition_multilevel(torus, 4) } };
+		for (const auto& pl : placements) {
+			LocalShards shards(torus, 4, "/tmp", pl.second);
+			ShardClient client(shards.paths(), pl.second);
+			vector<int> circuit;
+			measure(string(pl.first) + " placement", torus_edges,
+				[&] { circuit = client.find_path(); });
+			cout << "    " << client.trails().size() << " trails\n";
+			if (!is_circuit(circuit)) {
+				cout << "FAIL: distributed Euler circuit is not a circuit of the graph\n";
+				failed = true;
+			}
+		}
+	}
+
+	// Frozen snapshots under each allocation policy
+	const pair<AllocPolicy, const char*> policies[] = {
+		{ AllocPolicy::Default, "default" },
+		{ AllocPolicy::HugePages, "huge pages" },
+		{ AllocPolicy::ExplicitHuge, "explicit huge" },
+		{ AllocPolicy::Interleave, "interleave" } };
+	cout << "\nFrozen graph (" << page_array::numa_nodes() << " NUMA nodes):\n";
+	for (const auto& p : policies) {
+		FrozenGraph<int> f;
+		cout << p.second << "\n";
+		measure("  freeze", e, [&] { f = FrozenGraph<int>(g, p.first); });
+		measure("  scan", e, [&] {
+			for (size_t i = 0; i < f.vertex_count(); i++)
+				for (size_t j : f.neighbors(i))
+					sum += j;
+		});
+		mt19937 frng(2);
+		measure("  is_edge", e, [&] {
+			for (size_t i = 0; i < e; i++)
+				sum += f.is_edge(pick(frng), pick(frng));
+		});
+		if (!f.huge_pages() && p.first != AllocPolicy::Default)
+			cout << (f.edge_count() * sizeof(size_t) < page_array::HUGE_PAGE
+				? "    (below the huge page size, so on the heap)\n"
+				: "    (huge pages unavailable)\n");
+	}
+
+	// Snapshots filled in parallel, and copied from another snapshot
+	{
+		Scheduler& sched = Scheduler::instance();
+		FrozenGraph<int> f1(g), f2, f3;
+		cout << "parallel (" << sched.concurrency() << " workers)\n";
+		measure("  freeze", e, [&] { f2 = FrozenGraph<int>(g, AllocPolicy::Default, &sched); });
+		measure("  clone", e, [&] { f3 = f1.clone(); });
+		bool same = f2.edge_count() == f1.edge_count() && f3.edge_count() == f1.edge_count();
+		for (size_t i = 0; same && i < f1.vertex_count(); i++)
+			same = f2.vertex(i) == f1.vertex(i) && f3.vertex(i) == f1.vertex(i)
+				&& f2.offset(i) == f1.offset(i) && f3.offset(i) == f1.offset(i);
+		for (size_t k = 0; same && k < f1.edge_count(); k++)
+			same = f2.target(k) == f1.target(k) && f3.target(k) == f1.target(k)
+				&& f2.edge_weight(k) == f1.edge_weight(k) && f3.edge_weight(k) == f1.edge_weight(k);
+		if (!same) {
+			cout << "FAIL: parallel snapshot or clone differs\n";
+			failed = true;
+		}
+	}
+
+	// Traversals with and without software prefetching
+	FrozenGraph<int> f(g, AllocPolicy::HugePages);
+	vector<size_t> dist, dist_pf;
+	cout << "\nTraversal:\n";
+	measure("bfs", e, [&] { bfs(f, 0, dist, 0); });
+	measure("bfs prefetch " + to_string(pf), e, [&] { bfs(f, 0, dist_pf, pf); });
+	if (dist != dist_pf) {
+		cout << "FAIL: prefetching bfs found different distances\n";
+		failed = true;
+	}
+
+	// Euler precheck over the offsets, repeated as if triaging many graphs;
+	// times are per vertex
+	{
+		DegreeParity expect;
+		for (size_t i = 0; i < f.vertex_count(); i++)
+			if (f.degree_out(i) % 2) {
+				if (expect.odd == 0)
+					expect.first = i;
+				else if (expect.odd == 1)
+					expect.second = i;
+				expect.odd++;
+			}
+		const pair<const char*, ParityKernel> kernels[] = { { "parity scalar", ParityKernel::Scalar },
+			{ "parity avx2", ParityKernel::Avx2 }, { "parity avx512", ParityKernel::Avx512 } };
+		for (const auto& k : kernels) {
+			DegreeParity r;
+			measure(k.first, 100 * f.vertex_count(), [&] {
+				for (int i = 0; i < 100; i++)
+					r = f.degree_parity(k.second);
+			});
+			if (r.odd != expect.odd || r.first != expect.first || r.second != expect.second) {
+				cout << "FAIL: " << k.first << " found different odd vertices\n";
+				failed = true;
+			}
+		}
+	}
+
+	// A torus numbered at random with gaps, as left by removals, compacted
+	// in ascending and in breadth-first order; traversals of the second
+	// read nearby memory
+	{
+		const int side = 500;
+		vector<int> label(side * side);
+		iota(label.begin(), label.end(), 0);
+		shuffle(label.begin(), label.end(), mt19937(5));
+		Graph<int> torus = torus_graph(side), sparse;
+		for (auto [v1, v2, w] : torus.edge_view())
+			sparse.update_edge(16 * label[v1 - 1] + 16, 16 * label[v2 - 1] + 16, w);
+		size_t te = 4 * (size_t) side * side;
+		Graph<int> ascending(sparse), local(sparse);
+		vector<pair<int, int> > renumber;
+		measure("compact", te, [&] { renumber = ascending.compact(VertexOrder::Ascending, 1); });
+		measure("compact bfs order", te, [&] { local.compact(VertexOrder::BreadthFirst, 1); });
+		auto new_of = [&](int v) {
+			return lower_bound(renumber.begin(), renumber.end(), make_pair(v, 0))->second;
+		};
+		auto edge_count = [](const Graph<int>& h) {
+			EdgeView<int> ev = h.edge_view();
+			return (size_t) distance(ev.begin(), ev.end());
+		};
+		bool same = edge_count(ascending) == te && edge_count(local) == te
+			&& renumber.size() == (size_t) side * side
+			&& renumber.back().second == side * side;
+		for (auto [v1, v2, w] : sparse.edge_view())
+			same = same && ascending.weight(new_of(v1), new_of(v2)) == w;
+		if (!same) {
+			cout << "FAIL: compacted graph differs\n";
+			failed = true;
+		}
+		FrozenGraph<int> fa(ascending), fl(local);
+		vector<size_t> da, dl;
+		measure("bfs ascending", te, [&] { bfs(fa, 0, da, 0); });
+		measure("bfs bfs order", te, [&] { bfs(fl, 0, dl, 0); });
+	}
+
+	// One edge attribute scanned from a side table and from a column
+	GraphAttributes<int> attrs(f);
+	Column<double>& cost = attrs.edge_column<double>("cost");
+	Column<uint32_t>& stamp = attrs.edge_column<uint32_t>("timestamp");
+	map<pair<int, int>, double> side;
+	for (size_t i = 0; i < f.vertex_count(); i++)
+		for (size_t k = f.offset(i); k < f.offset(i + 1); k++) {
+			cost[k] = (double) (k % 100);
+			stamp[k] = (uint32_t) k;
+			side[{ f.vertex(i), f.vertex(f.target(k)) }] = cost[k];
+		}
+	double side_sum = 0, col_sum = 0;
+	cout << "\nAttributes:\n";
+	measure("side table sum", e, [&] {
+		for (size_t i = 0; i < f.vertex_count(); i++)
+			for (size_t j : f.neighbors(i))
+				side_sum += side.at({ f.vertex(i), f.vertex(j) });
+	});
+	measure("column sum", e, [&] {
+		for (double c : cost)
+			col_sum += c;
+	});
+	measure("column filter", e, [&] {
+		// Edges in the first half of the timestamps
+		uint32_t cut = (uint32_t) (e / 2);
+		for (uint32_t s : stamp)
+			sum += s < cut;
+	});
+	if (side_sum != col_sum
+			|| attrs.of_edge(cost, f.vertex(0), f.vertex(f.target(0))) != cost[0]) {
+		cout << "FAIL: edge attribute column differs from side table\n";
+		failed = true;
+	}
+	side.clear();
+
+	// Parallel loops on the shared work-stealing scheduler
+	cout << "\nParallel (" << Scheduler::instance().concurrency() << " workers):\n";
+	long serial_sum = 0;
+	measure("scan", e, [&] {
+		for (size_t i = 0; i < f.vertex_count(); i++)
+			for (size_t j : f.neighbors(i))
+				serial_sum += j;
+	});
+	atomic<long> par_sum{0};
+	measure("parallel scan", e, [&] {
+		parallel_for_weighted(0, f.vertex_count(),
+			[&](size_t i) { return f.offset(i) + i; },
+			[&](size_t lo, size_t hi) {
+				long local = 0;
+				for (size_t i = lo; i < hi; i++)
+					for (size_t j : f.neighbors(i))
+						local += j;
+				par_sum += local;
+			});
+	});
+	if (par_sum != serial_sum) {
+		cout << "FAIL: parallel scan sum differs\n";
+		failed = true;
+	}
+	cout << "\n";
+
+	// Euler paths need a graph with at most two odd vertices; every vertex of
+	// a torus grid has degree four
+	Graph<int> t = torus_graph(150);
+	size_t te = 4 * 150 * 150;
+	list<int> path;
+	measure("find_path", te, [&] { path = find_path(t); });
+	EulerWorkspace ws;
+	auto solve = [&] { sum += ws.find_path(t).size(); };
+	measure("workspace path", te, solve);
+	const vector<int> ws_path = ws.find_path(t);
+	if (!equal(path.begin(), path.end(), ws_path.begin(), ws_path.end())) {
+		cout << "FAIL: workspace path differs from find_path\n";
+		failed = true;
+	}
+	EulerResult async_result;
+	measure("async path", te, [&] { async_result = find_path_async(t).get(); });
+	if (async_result.status != EulerStatus::Found || async_result.path != ws_path) {
+		cout << "FAIL: async path differs from find_path\n";
+		failed = true;
+	}
+	{
+		// A budget far too small for the graph must stop the search early
+		EulerHandle h = find_path_async(t, chrono::milliseconds(5));
+		EulerResult r = h.get();
+		cout << "    5 ms budget: " << (r.status == EulerStatus::TimedOut
+			? "timed out" : "finished") << " after " << h.edges_used()
+			<< " of " << h.edge_total() << " edges\n";
+		EulerHandle c = find_path_async(t);
+		c.cancel();
+		if (c.get().status != EulerStatus::Cancelled) {
+			cout << "FAIL: cancelled search was not cancelled\n";
+			failed = true;
+		}
+	}
+
+	// Repeated queries answered from the cache in fingerprint time
+	EulerCache cache;
+	measure("fingerprint", te, [&] { sum += t.fingerprint() & 1; });
+	measure("cache miss", te, [&] { sum += cache.find_path(t)->size(); });
+	measure("cache hit", te, [&] { sum += cache.find_path(t)->size(); });
+	Graph<int> t_reversed;
+	for (int v = 150 * 150; v >= 1; v--)
+		for (int u : t.neighbor_view(v))
+			t_reversed.add_edge(v, u);
+	if (cache.hits() != 1 || *cache.find_path(t) != ws_path
+			|| t_reversed.fingerprint() != t.fingerprint()) {
+		cout << "FAIL: cache or fingerprint is inconsistent\n";
+		failed = true;
+	}
+
+	// A small graph's path is computed at compile time and must agree with
+	// find_path at run time
+	constexpr auto sample_path = find_path(sample_graph<SmallGraph<8> >());
+	static_assert(sample_path.size == 13, "sample graph has 12 edges");
+	list<int> sample_expected = find_path(sample_graph<Graph<int> >());
+	if (!equal(sample_path.begin(), sample_path.end(), sample_expected.begin(),
+			sample_expected.end())) {
+		cout << "FAIL: small graph path differs from find_path\n";
+		failed = true;
+	}
+	SmallGraph<8> small = sample_graph<SmallGraph<8> >();
+	auto small_solve = [&] { sum += find_path(small).size; };
+	measure("small graph path", 24, small_solve);
+
+	vector<Graph<int> > batch(16, torus_graph(40));
+	measure("batch paths", 16 * 4 * 40 * 40, [&] { sum += find_paths(batch).size(); });
+
+	// Paths over windows of a temporal graph whose edges are the torus edges,
+	// one per time step; rebuilding a Graph per window is the alternative
+	vector<pair<int, int> > timeline;
+	for (int v : t.vertex_view())
+		for (int u : t.neighbor_view(v))
+			if (v <= u)
+				timeline.push_back({ v, u });
+	TemporalGraph<int> tg;
+	for (size_t k = 0; k < timeline.size(); k++)
+		tg.add_edge(timeline[k].first, timeline[k].second, k, k + 1);
+	const size_t windows = 10;
+	auto window_end = [&](size_t w) { return (w + 1) * timeline.size() / windows; };
+	vector<size_t> rebuilt_sizes, window_sizes;
+	measure("rebuild windows", te, [&] {
+		for (size_t w = 0; w < windows; w++) {
+			Graph<int> part;
+			for (size_t k = 0; k < window_end(w); k++)
+				part.add_edge(timeline[k].first, timeline[k].second);
+			rebuilt_sizes.push_back(find_path(part).size());
+		}
+	});
+	measure("temporal windows", te, [&] {
+		for (size_t w = 0; w < windows; w++)
+			window_sizes.push_back(tg.window(0, window_end(w)).find_path().size());
+	});
+	if (rebuilt_sizes != window_sizes
+			|| window_sizes.back() != timeline.size() + 1
+			|| tg.window(0, timeline.size()).reachable(1).size() != 150 * 150) {
+		cout << "FAIL: temporal window paths differ from rebuilt graphs\n";
+		failed = true;
+	}
+
+	// Trail output, to /dev/null so only formatting and buffering are timed
+	FILE* null_file = fopen("/dev/null", "w");
+	ofstream null_stream("/dev/null");
+	measure("trail ostream", te, [&] {
+		for (int v : ws_path)
+			null_stream << " " << v;
+		null_stream << flush;
+	});
+	measure("trail text", te, [&] {
+		TrailWriter w(null_file);
+		w.write_trail(ws_path);
+	});
+	measure("trail binary", te, [&] {
+		TrailWriter w(null_file, TrailWriter::Format::Binary);
+		w.write_trail(ws_path);
+	});
+	fclose(null_file);
+
+	// Splitting strategies on a skewed graph; the per-edge work looks up the
+	// degree of each neighbor
+	FrozenGraph<int> r(rmat_graph(16, 8 << 16, 3));
+	size_t max_degree = 0;
+	for (size_t i = 0; i < r.vertex_count(); i++)
+		max_degree = max(max_degree, r.degree_out(i));
+	cout << "\nR-MAT: " << r.vertex_count() << " vertices, " << r.edge_count()
+		<< " edges, max degree " << max_degree << "\n";
+	for (size_t threads : { 1, 2, 4, 8 }) {
+		Scheduler s(threads);
+		atomic<long> by_count{0}, by_degree{0}, by_edge{0};
+		auto edge_work = [&](size_t v, atomic<long>& total) {
+			long local = 0;
+			for (size_t j : r.neighbors(v))
+				local += r.degree_out(j);
+			total += local;
+		};
+		measure("  " + to_string(threads) + " by vertex", r.edge_count(), [&] {
+			parallel_for(0, r.vertex_count(), [&](size_t lo, size_t hi) {
+				for (size_t i = lo; i < hi; i++)
+					edge_work(i, by_count);
+			}, 0, s);
+		});
+		measure("  " + to_string(threads) + " by degree", r.edge_count(), [&] {
+			parallel_for_weighted(0, r.vertex_count(),
+				[&](size_t i) { return r.offset(i) + i; },
+				[&](size_t lo, size_t hi) {
+					for (size_t i = lo; i < hi; i++)
+						edge_work(i, by_degree);
+				}, 0, s);
+		});
+		measure("  " + to_string(threads) + " by edge", r.edge_count(), [&] {
+			parallel_for_edges(r, [&](size_t, size_t lo, size_t hi) {
+				long local = 0;
+				for (size_t k = lo; k < hi; k++)
+					local += r.degree_out(r.target(k));
+				by_edge += local;
+			}, 0, s);
+		});
+		if (by_count != by_degree || by_count != by_edge) {
+			cout << "FAIL: splitting strategies disagree\n";
+			failed = true;
+		}
+	}
+
+	if (check_alloc) {
+		cout << "\nAllocation checks:\n";
+		check_no_alloc("neighbor view", view_scan);
+		check_no_alloc("edge view", edge_scan);
+		check_no_alloc("is_edge", probe);
+		check_no_alloc("workspace path", solve);
+		check_no_alloc("small graph path", small_solve);
+	}
+
+	cout << "\n(checksum " << sum << ")\n";
+	return failed;
+}
+
+/**
+ * @brief Generate a random undirected graph
+ *
+ * @param n Number of vertices, numbered 1 through n
+ * @param m Number of edge insertions attempted
+ * @param seed Seed for the random number generator
+ * @return Graph<int> The graph; duplicate edges and loops are dropped, so it
+ * may have slightly fewer than m edges
+ */
+Graph<int> random_graph (int n, int m, unsigned seed) {
+	Graph<int> g;
+	mt19937 rng(seed);
+	uniform_int_distribution<int> pick(1, n);
+	for (int v = 1; v <= n; v++)
+		g.add_vertex(v);
+	for (int i = 0; i < m; i++) {
+		int v1 = pick(rng), v2 = pick(rng);
+		if (v1 != v2)
+			g.add_edge(v1, v2);
+	}
+	return g;
+}
+
+/**
+ * @brief Generate a torus grid graph
+ *
+ * @param side Number of vertices along each side
+ * @return Graph<int> Graph with side * side vertices, numbered from 1, each
+ * joined to its four neighbors with wraparound
+ */
+Graph<int> torus_graph (int side) {
+	Graph<int> g;
+	for (int r = 0; r < side; r++) {
+		for (int c = 0; c < side; c++) {
+			int v = r * side + c + 1;
+			g.add_edge(v, r * side + (c + 1) % side + 1);
+			g.add_edge(v, (r + 1) % side * side + c + 1);
+		}
+	}
+	return g;
+}
+
+/**
+ * @brief Generate a recursive matrix (R-MAT) graph
+ *
+ * @param scale Log base 2 of the number of vertices, numbered from 1
+ * @param m Number of edge insertions attempted
+ * @param seed Seed for the random number generator
+ * @return DiGraph<int> Directed graph with a power-law degree distribution;
+ * duplicate edges and loops are dropped
+ *
+ * Each edge is placed by descending scale levels of the adjacency matrix,
+ * choosing a quadrant with probabilities 0.57, 0.19, 0.19 and 0.05.
+ */
+DiGraph<int> rmat_graph (int scale, int m, unsigned seed) {
+	DiGraph<int> g;
+	mt19937 rng(seed);
+	uniform_real_distribution<double> coin(0, 1);
+	for (int i = 0; i < m; i++) {
+		int v1 = 0, v2 = 0;
+		for (int bit = 0; bit < scale; bit++) {
+			double x = coin(rng);
+			v1 = v1 << 1 | (x >= 0.76);
+			v2 = v2 << 1 | (x >= 0.57 && x < 0.76) | (x >= 0.95);
+		}
+		if (v1 != v2)
+			g.add_edge(v1 + 1, v2 + 1);
+	}
+	return g;
+}
+
+/**
+ * @brief Check that a region of code does not allocate
+ *
+ * @param name Name of the region
+ * @param f The region to be checked
+ *
+ * Runs f once to warm up any reusable storage, then again while counting
+ * heap allocations. Any allocation is reported and fails the run.
+ */
+template <typename F>
+void check_no_alloc (const string& name, F f) {
+	f();
+	AllocationScope scope;
+	f();
+	size_t n = scope.count();
+	cout << "    " << left << setw(20) << name << right
+		<< (n ? "FAIL: " + to_string(n) + " allocations" : "ok") << "\n";
+	if (n)
+		failed = true;
+}
+
+/**
+ * @brief Time a region of code and report per-edge costs
+ *
+ * @param name Name of the region
+ * @param edges Number of edges the region touches, for per-edge metrics
+ * @param f The region to be measured
+ *
+ * Prints wall time and nanoseconds per edge. With --perf, also prints each
+ * available hardware counter as a total and per edge, summed over all
+ * threads.
+ */
+template <typename F>
+void measure (const string& name, size_t edges, F f) {
+	if (use_perf)
+		counters->start();
+	auto start = chrono::steady_clock::now();
+	f();
+	auto stop = chrono::steady_clock::now();
+	if (use_perf)
+		counters->stop();
+
+	double ns = chrono::duration<double, nano>(stop - start).count();
+	cout << left << setw(20) << name << right << fixed << setprecision(2)
+		<< setw(12) << ns / 1e6 << " ms" << setw(10) << ns / edges << " ns/edge\n";
+	if (!use_perf)
+		return;
+	if (!counters->available()) {
+		cout << "    (hardware counters unavailable)\n";
+		return;
+	}
+	for (int i = 0; i < PerfCounters::NUM_EVENTS; i++) {
+		auto ev = (PerfCounters::Event) i;
+		if (counters->has(ev))
+			cout << "    " << left << setw(16) << PerfCounters::name(ev) << right
+				<< setw(16) << counters->value(ev) << setw(12) << setprecision(3)
+				<< (double) counters->value(ev) / edges << " /edge\n";
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define DEGREE_PARITY_X86 1
+#endif
+
+/**
+ * @brief Vertices of odd degree in a graph, as found by degree_parity()
+ *
+ * A connected graph has an Euler circuit if odd is 0, and an Euler path
+ * from first to second if odd is 2.
+ */
+struct DegreeParity {
+	static constexpr size_t npos = (size_t) -1;
+	size_t odd = 0;       // Number of vertices of odd degree
+	size_t first = npos;  // Index of the first of them, or npos
+	size_t second = npos; // Index of the second of them, or npos
+
+	/**
+	 * @brief Determine if the degrees allow an Euler path or circuit
+	 *
+	 * @return true There are 0 or 2 vertices of odd degree
+	 * @return false There are more, so no Euler path exists
+	 */
+	bool eulerian() const { return odd == 0 || odd == 2; }
+};
+
+/**
+ * @brief Instruction set used by degree_parity()
+ *
+ * Auto picks the widest one the processor supports. A kernel the processor
+ * lacks falls back to Scalar.
+ */
+enum class ParityKernel { Auto, Scalar, Avx2, Avx512 };
+
+namespace parity_detail {
+	// Add the odd vertices flagged in mask, bit i for vertex base + i
+	inline void note(DegreeParity& r, uint64_t mask, size_t base) {
+		r.odd += __builtin_popcountll(mask);
+		for (; mask && r.second == DegreeParity::npos; mask &= mask - 1)
+			(r.first == DegreeParity::npos ? r.first : r.second)
+				= base + __builtin_ctzll(mask);
+	}
+
+	// Gathers a mask of up to 64 vertices at a time, without branching on
+	// each vertex
+	inline void scalar(const size_t* offsets, size_t lo, size_t hi, DegreeParity& r) {
+		while (lo < hi) {
+			size_t count = hi - lo < 64 ? hi - lo : 64;
+			uint64_t mask = 0;
+			for (size_t i = 0; i < count; i++)
+				mask |= (uint64_t) ((offsets[lo + i] ^ offsets[lo + i + 1]) & 1) << i;
+			note(r, mask, lo);
+			lo += count;
+		}
+	}
+
+#ifdef DEGREE_PARITY_X86
+	// Each kernel handles a prefix of the vertices and returns its length
+
+	__attribute__((target("avx2")))
+	inline size_t avx2(const size_t* offsets, size_t n, DegreeParity& r) {
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			__m256i a = _mm256_loadu_si256((const __m256i*) (offsets + i));
+			__m256i b = _mm256_loadu_si256((const __m256i*) (offsets + i + 1));
+			// Move the low bit of each difference to the sign bit
+			__m256i odd = _mm256_slli_epi64(_mm256_xor_si256(a, b), 63);
+			unsigned mask = _mm256_movemask_pd(_mm256_castsi256_pd(odd));
+			if (mask)
+				note(r, mask, i);
+		}
+		return i;
+	}
+
+	__attribute__((target("avx512f")))
+	inline size_t avx512(const size_t* offsets, size_t n, DegreeParity& r) {
+		const __m512i one = _mm512_set1_epi64(1);
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m512i a = _mm512_loadu_si512(offsets + i);
+			__m512i b = _mm512_loadu_si512(offsets + i + 1);
+			__mmask8 mask = _mm512_test_epi64_mask(_mm512_xor_si512(a, b), one);
+			if (mask)
+				note(r, mask, i);
+		}
+		return i;
+	}
+#endif
+}
+
+/**
+ * @brief Find the vertices of odd degree from compressed sparse row offsets
+ *
+ * @param offsets Position of each vertex's first edge, n + 1 entries with
+ * the last giving the edge count
+ * @param n Number of vertices
+ * @param kernel Instruction set to use
+ * @return DegreeParity Count of odd vertices and the first two of them
+ *
+ * A vertex's degree is odd exactly when the low bits of its offset and the
+ * next differ, so one pass compares the offsets with themselves shifted by
+ * one, four or eight at a time with AVX2 or AVX-512.
+ */
+inline DegreeParity degree_parity(const size_t* offsets, size_t n,
+	ParityKernel kernel = ParityKernel::Auto) {
+	DegreeParity r;
+	size_t i = 0;
+#ifdef DEGREE_PARITY_X86
+	bool auto_pick = kernel == ParityKernel::Auto;
+	if ((auto_pick || kernel == ParityKernel::Avx512) && __builtin_cpu_supports("avx512f"))
+		i = parity_detail::avx512(offsets, n, r);
+	else if ((auto_pick || kernel == ParityKernel::Avx2) && __builtin_cpu_supports("avx2"))
+		i = parity_detail::avx2(offsets, n, r);
+#else
+	(void) kernel;
+#endif
+	parity_detail::scalar(offsets, i, n, r);
+	return r;
+}
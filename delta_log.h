@@ -0,0 +1,228 @@
+#pragma once
+
+#include "graph.h"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template <typename T>
+bool replay_delta(const uint8_t* p, size_t n, DiGraph<T>& g);
+
+/**
+ * @brief A compact binary record of changes to a graph
+ *
+ * @tparam T Data type of vertices, which must be an integer type
+ *
+ * Attach to a DiGraph with set_listener() to record each change as it is
+ * made, or fill with diff() to record the changes between two versions of a
+ * graph. Replaying the record on a copy of the original graph brings the
+ * copy up to date, so a replica can be sent the record instead of the whole
+ * graph.
+ *
+ * Each change is one byte giving its kind, followed by its arguments as
+ * LEB128 varints. The first vertex is zigzag-encoded as its difference from
+ * the first vertex of the previous change, and the second as its difference
+ * from the first, so changes to nearby vertices take a few bytes each. A
+ * compaction is one change, holding its arguments and the mapping it
+ * produced; replay runs the same compaction and checks that the mapping
+ * agrees.
+ */
+template <typename T>
+class DeltaLog : public GraphListener<T> {
+	static_assert(std::is_integral<T>::value, "DeltaLog requires integer vertices");
+public:
+	enum Op : uint8_t { AddVertex, RemoveVertex, UpdateEdge, RemoveEdge, Compact };
+
+	void vertex_added(const T& v) override { op(AddVertex, v); }
+	void vertex_removed(const T& v) override { op(RemoveVertex, v); }
+	void edge_updated(const T& v1, const T& v2, size_t w) override
+		{ op(UpdateEdge, v1); vertex(v2, v1); varint(w); }
+	void edge_removed(const T& v1, const T& v2) override
+		{ op(RemoveEdge, v1); vertex(v2, v1); }
+	void compacted(VertexOrder order, const T& first,
+		const std::vector<std::pair<T, T> >& mapping) override {
+		// Old numbers ascend, and new ones are dense, so each is coded as
+		// its difference from the one before
+		op(Compact, first);
+		varint((uint64_t) order);
+		varint(mapping.size());
+		int64_t from = 0, to = (int64_t) first;
+		for (const auto& p : mapping) {
+			vertex(p.first, from);
+			vertex(p.second, to);
+			from = (int64_t) p.first;
+			to = (int64_t) p.second;
+		}
+	}
+
+	const std::vector<uint8_t>& bytes() const { return buf; }
+	size_t size() const { return buf.size(); }
+	size_t count() const { return changes; }
+	void clear() { buf.clear(); changes = 0; prev = 0; }
+
+	/**
+	 * @brief Apply the recorded changes to a graph
+	 *
+	 * @param g The graph, normally a copy of the one the changes were made to
+	 * @return true The changes were applied
+	 * @return false The record is malformed; changes before the fault were
+	 * applied
+	 */
+	bool replay(DiGraph<T>& g) const { return replay_delta(buf.data(), buf.size(), g); }
+
+private:
+	std::vector<uint8_t> buf;
+	size_t changes = 0;
+	int64_t prev = 0; // First vertex of the previous change
+
+	void op(Op o, const T& v) {
+		buf.push_back(o);
+		changes++;
+		vertex(v, prev);
+		prev = (int64_t) v;
+	}
+	void vertex(const T& v, int64_t base) {
+		int64_t d = (int64_t) v - base;
+		varint(((uint64_t) d << 1) ^ (uint64_t) (d >> 63));
+	}
+	void varint(uint64_t x) {
+		while (x >= 0x80) {
+			buf.push_back((uint8_t) (x | 0x80));
+			x >>= 7;
+		}
+		buf.push_back((uint8_t) x);
+	}
+};
+
+/**
+ * @brief Apply a record written by DeltaLog to a graph
+ *
+ * @tparam T Data type of vertices, which must be an integer type
+ * @param p The record
+ * @param n Length of the record in bytes
+ * @param g The graph to change
+ * @return true The changes were applied
+ * @return false The record is malformed; changes before the fault were
+ * applied
+ */
+template <typename T>
+bool replay_delta(const uint8_t* p, size_t n, DiGraph<T>& g) {
+	const uint8_t* end = p + n;
+	auto varint = [&](uint64_t& x) {
+		x = 0;
+		for (int shift = 0; shift < 64 && p < end; shift += 7) {
+			uint8_t c = *p++;
+			x |= (uint64_t) (c & 0x7f) << shift;
+			if (!(c & 0x80))
+				return true;
+		}
+		return false;
+	};
+	auto vertex = [&](int64_t base, int64_t& v) {
+		uint64_t z;
+		if (!varint(z))
+			return false;
+		v = base + ((int64_t) (z >> 1) ^ -(int64_t) (z & 1));
+		return true;
+	};
+
+	int64_t prev = 0, v2;
+	uint64_t w, order, count;
+	std::vector<std::pair<T, T> > mapping;
+	while (p < end) {
+		uint8_t o = *p++;
+		if (!vertex(prev, prev))
+			return false;
+		switch (o) {
+		case DeltaLog<T>::AddVertex:
+			g.add_vertex((T) prev);
+			break;
+		case DeltaLog<T>::RemoveVertex:
+			g.remove((T) prev);
+			break;
+		case DeltaLog<T>::UpdateEdge:
+			if (!vertex(prev, v2) || !varint(w))
+				return false;
+			g.update_edge((T) prev, (T) v2, w);
+			break;
+		case DeltaLog<T>::RemoveEdge:
+			if (!vertex(prev, v2))
+				return false;
+			g.remove_edge((T) prev, (T) v2);
+			break;
+		case DeltaLog<T>::Compact: {
+			if (!varint(order) || order > (uint64_t) VertexOrder::BreadthFirst
+					|| !varint(count))
+				return false;
+			mapping = g.compact((VertexOrder) order, (T) prev);
+			if (count != mapping.size())
+				return false;
+			int64_t from = 0, to = prev, v1;
+			for (const auto& q : mapping) {
+				if (!vertex(from, v1) || !vertex(to, v2)
+						|| (T) v1 != q.first || (T) v2 != q.second)
+					return false;
+				from = v1;
+				to = v2;
+			}
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Record the changes that turn one graph into another
+ *
+ * @tparam T Data type of vertices, which must be an integer type
+ * @param from The older graph
+ * @param to The newer graph
+ * @param log Receives the changes; replaying them on a copy of from makes
+ * it equal to to
+ *
+ * Walks the sorted vertices of both graphs, and the sorted neighbors of
+ * each vertex in both, in lockstep, so takes time linear in the size of the
+ * two graphs. Edges into a removed vertex may be recorded as removed before
+ * the vertex itself is.
+ */
+template <typename T>
+void diff(const DiGraph<T>& from, const DiGraph<T>& to, DeltaLog<T>& log) {
+	VertexView<T> a = from.vertex_view(), b = to.vertex_view();
+	auto i = a.begin(), j = b.begin();
+	while (i != a.end() || j != b.end()) {
+		if (j == b.end() || (i != a.end() && *i < *j)) {
+			log.vertex_removed(*i);
+			++i;
+		} else if (i == a.end() || *j < *i) {
+			log.vertex_added(*j);
+			NeighborView<T> nb = j.neighbors();
+			for (auto q = nb.begin(); q != nb.end(); ++q)
+				log.edge_updated(*j, *q, q.weight());
+			++j;
+		} else {
+			NeighborView<T> na = i.neighbors(), nb = j.neighbors();
+			auto p = na.begin(), q = nb.begin();
+			while (p != na.end() || q != nb.end()) {
+				if (q == nb.end() || (p != na.end() && *p < *q)) {
+					log.edge_removed(*i, *p);
+					++p;
+				} else if (p == na.end() || *q < *p) {
+					log.edge_updated(*j, *q, q.weight());
+					++q;
+				} else {
+					if (p.weight() != q.weight())
+						log.edge_updated(*j, *q, q.weight());
+					++p;
+					++q;
+				}
+			}
+			++i;
+			++j;
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Counting Bloom filter over the edges of a graph
+ *
+ * Answers whether an edge may exist, given a hash of the edge: a false
+ * answer is always right, and a true answer is wrong for about 2% of edges
+ * that do not exist while the filter holds no more edges than it was sized
+ * for. Edges can be removed as well as added, since each slot holds a
+ * count; a count that reaches 255 stays there, which only makes false
+ * positives slightly more likely.
+ *
+ * The filter is blocked: all of an edge's slots lie in one 64-byte block,
+ * so a query touches a single cache line. An empty (default constructed)
+ * filter is disabled and answers true for every edge.
+ */
+class EdgeFilter {
+public:
+	EdgeFilter() = default;
+
+	/**
+	 * @brief Create an empty filter
+	 *
+	 * @param expected Number of edges to size the filter for
+	 */
+	explicit EdgeFilter(size_t expected)
+		: blocks((expected * SLOTS_PER_EDGE + 63) / 64 + 1), capacity(expected) { }
+
+	bool enabled() const { return !blocks.empty(); }
+	size_t size() const { return count; }
+	size_t bytes() const { return blocks.size() * sizeof(Block); }
+
+	/**
+	 * @brief Determine if the filter holds more edges than it was sized for,
+	 * so that it should be rebuilt larger
+	 */
+	bool crowded() const { return count > capacity; }
+
+	void insert(uint64_t h) {
+		Block& b = block(h);
+		for (int i = 0; i < PROBES; i++) {
+			uint8_t& c = b.c[slot(h, i)];
+			if (c != 255)
+				c++;
+		}
+		count++;
+	}
+
+	void erase(uint64_t h) {
+		Block& b = block(h);
+		for (int i = 0; i < PROBES; i++) {
+			uint8_t& c = b.c[slot(h, i)];
+			if (c && c != 255)
+				c--;
+		}
+		count--;
+	}
+
+	bool may_contain(uint64_t h) const {
+		if (!enabled())
+			return true;
+		const Block& b = block(h);
+		for (int i = 0; i < PROBES; i++)
+			if (!b.c[slot(h, i)])
+				return false;
+		return true;
+	}
+
+private:
+	static constexpr size_t SLOTS_PER_EDGE = 8;
+	static constexpr int PROBES = 5;
+
+	struct alignas(64) Block {
+		uint8_t c[64] = {};
+	};
+
+	std::vector<Block> blocks;
+	size_t capacity = 0;
+	size_t count = 0;
+
+	// High bits choose the block, low bits the slots within it
+	Block& block(uint64_t h) { return blocks[(h >> 32) * blocks.size() >> 32]; }
+	const Block& block(uint64_t h) const { return blocks[(h >> 32) * blocks.size() >> 32]; }
+	static size_t slot(uint64_t h, int i) { return (h >> (6 * i)) & 63; }
+};
@@ -0,0 +1,421 @@
+#pragma once
+
+#include "degree_parity.h"
+#include "graph.h"
+#include "scheduler.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <list>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Extend a path along unused edges until it cannot be extended
+ * 
+ * @param g The graph, from which each edge is removed as it is used
+ * @param p The path, which must contain at least its starting vertex
+ * 
+ * At each step, follows the edge from the end of the path to its smallest
+ * neighbor other than the starting vertex, returning to the starting vertex
+ * only when there is no other choice. Assumes there is no vertex 0.
+ */
+inline void extend_path (Graph<int>& g, std::list<int>& p) {
+	// If end of path has no neighbors, we're done
+	if (!g.degree(p.back()))
+		return;
+
+	// Find a neighbor of last vertex on path, but not starting vertex
+	int v_next = 0; // Next vertex on path, assumes no vertex 0
+	for (int v : g.neighbors(p.back()))
+		if (!v_next && v != p.front())
+			v_next = v;
+
+	// If no vertex found, starting vertex is the only neighbor
+	if (!v_next)
+		v_next = p.front();
+
+	// Remove from g the edge from end of the path to next vertex
+	g.remove_edge(p.back(), v_next);
+
+	// Add next vertex to end of path
+	p.push_back(v_next);
+
+	// Find next edge along the path
+	extend_path(g, p);
+}
+
+/**
+ * @brief Find an Euler path or circuit in a graph
+ * 
+ * @param g The graph of interest
+ * @return std::list<int> The vertices along the path, or an empty list if
+ * the graph has no Euler path
+ * 
+ * A path begins at the first vertex of odd degree if there is one, else at
+ * the first vertex of the graph. Assumes there is no vertex 0.
+ */
+inline std::list<int> find_path (const Graph<int>& g) {
+	TRACE_SCOPE("find_path");
+
+	// Find first odd vertex, if any, and count odd vertices along the way
+	int count_odd = 0; // Count of vertices with odd degree
+	int first_odd = 0; // First vertex of odd degree, assumes no vertex #0
+	{
+		TRACE_SCOPE("degree scan");
+		VertexView<int> vv = g.vertex_view();
+		for (auto it = vv.begin(); it != vv.end(); ++it) {
+			if (it.neighbors().size() % 2) { // If vertex with odd degree
+				count_odd++; // Count v as among vertices with odd degree
+				if (!first_odd) // If first such vertex found
+					first_odd = *it; // Will be start path, if one exists
+			}
+		}
+	}
+
+	// For building a list of vertices to describe the path
+	std::list<int> p;
+
+	// If a path exists, find one
+	if (!count_odd || count_odd == 2) { // Must have 0 or 2 odd-degree vertices
+		// Add start vertex to the current path; the first odd-degree vertex
+		// encountered if one exists, else first vertex in the list of vertices
+		{
+			TRACE_SCOPE("start selection");
+			p.push_back(first_odd ? first_odd : g.vertices().front());
+		}
+		// Extend the path to form a path, passing a copy of the graph (which
+		// will be modified)
+		Graph<int> g_copy;
+		{
+			TRACE_SCOPE("graph copy");
+			g_copy = g;
+		}
+		TRACE_SCOPE("trail extension");
+		extend_path(g_copy, p);
+	}
+
+	// Return the path
+	return p;
+}
+
+/**
+ * @brief Outcome of a search for an Euler path
+ */
+enum class EulerStatus { Found, NoPath, Cancelled, TimedOut };
+
+/**
+ * @brief Lets another thread stop or watch a search for an Euler path
+ * 
+ * The search checks the flag and deadline every few thousand steps of each
+ * phase (flattening the graph, indexing and pairing its edges, and walking
+ * the path), so it stops within microseconds of either.
+ */
+struct EulerControl {
+	std::atomic<bool> cancelled{false};
+	std::chrono::steady_clock::time_point deadline =
+		std::chrono::steady_clock::time_point::max();
+	std::atomic<size_t> edges_used{0};  // Edges on the path so far
+	std::atomic<size_t> edge_total{0};  // Edges in the graph, once known
+};
+
+/**
+ * @brief Reusable storage for finding Euler paths without allocating
+ * 
+ * Produces the same path as find_path(), but instead of copying the graph
+ * and removing edges from the copy, flattens the graph into arrays and marks
+ * edges as used. The arrays are kept between calls, so once a workspace has
+ * seen a graph at least as large as the current one, find_path() performs
+ * no heap allocation.
+ */
+class EulerWorkspace {
+public:
+	/**
+	 * @brief Find an Euler path or circuit in a graph
+	 * 
+	 * @param g The graph of interest
+	 * @return const std::vector<int>& The vertices along the path, or an
+	 * empty vector if the graph has no Euler path. Valid until the next call.
+	 */
+	const std::vector<int>& find_path(const Graph<int>& g)
+		{ solve(g, nullptr); return path_; }
+
+	/**
+	 * @brief Find an Euler path or circuit, subject to cancellation
+	 * 
+	 * @param g The graph of interest
+	 * @param control Cancellation flag and deadline to obey, and progress
+	 * counters to update
+	 * @return EulerStatus Whether a path was found; if the search was stopped,
+	 * path() holds the part found so far
+	 */
+	EulerStatus find_path(const Graph<int>& g, EulerControl& control)
+		{ return solve(g, &control); }
+
+	/**
+	 * @brief Get the path from the last search
+	 * 
+	 * @return const std::vector<int>& The vertices along the path
+	 */
+	const std::vector<int>& path() const { return path_; }
+
+private:
+	std::vector<int> verts;       // Vertices in ascending order
+	std::vector<size_t> offsets;  // Start of each vertex's edges in targets
+	std::vector<size_t> targets;  // Index in verts of each edge's end vertex
+	std::vector<size_t> twins;    // Index of the same edge in reverse
+	std::vector<char> used;       // Whether each edge is already on the path
+	std::vector<size_t> cursors;  // First possibly unused edge of each vertex
+	std::vector<int> path_;
+
+	static constexpr size_t CHECK_INTERVAL = 1 << 12;
+
+	size_t index_of(int v) const
+		{ return std::lower_bound(verts.begin(), verts.end(), v) - verts.begin(); }
+	EulerStatus solve(const Graph<int>& g, EulerControl* control);
+	static EulerStatus check(const EulerControl& control);
+};
+
+inline EulerStatus EulerWorkspace::check(const EulerControl& control) {
+	if (control.cancelled.load(std::memory_order_relaxed))
+		return EulerStatus::Cancelled;
+	if (std::chrono::steady_clock::now() >= control.deadline)
+		return EulerStatus::TimedOut;
+	return EulerStatus::Found;
+}
+
+inline EulerStatus EulerWorkspace::solve(const Graph<int>& g, EulerControl* control) {
+	TRACE_SCOPE("workspace find_path");
+	EulerStatus status = EulerStatus::Found;
+	path_.clear();
+	verts.clear();
+	offsets.clear();
+	targets.clear();
+	for (int v : g.vertex_view()) {
+		verts.push_back(v);
+		offsets.push_back(targets.size());
+		for (int u : g.neighbor_view(v))
+			targets.push_back(u); // Vertex for now, index below
+		if (control && verts.size() % CHECK_INTERVAL == 0
+				&& (status = check(*control)) != EulerStatus::Found)
+			return status;
+	}
+	offsets.push_back(targets.size());
+	if (verts.empty())
+		return EulerStatus::NoPath;
+
+	// Same start selection as find_path(), checked before the edges are
+	// indexed so graphs without a path are rejected cheaply
+	DegreeParity parity = degree_parity(offsets.data(), verts.size());
+	if (!parity.eulerian())
+		return EulerStatus::NoPath;
+	// Indexing and pairing edges take O(E log V), so they check too
+	for (size_t k = 0; k < targets.size(); k++) {
+		targets[k] = index_of((int) targets[k]);
+		if (control && k % CHECK_INTERVAL == CHECK_INTERVAL - 1
+				&& (status = check(*control)) != EulerStatus::Found)
+			return status;
+	}
+
+	// Neighbors are sorted, so the reverse of an edge is found by search;
+	// a loop is its own reverse
+	twins.resize(targets.size());
+	size_t loops = 0;
+	for (size_t i = 0; i + 1 < offsets.size(); i++) {
+		for (size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+			auto first = targets.begin() + offsets[targets[k]];
+			auto last = targets.begin() + offsets[targets[k] + 1];
+			twins[k] = std::lower_bound(first, last, i) - targets.begin();
+			loops += twins[k] == k;
+			if (control && k % CHECK_INTERVAL == CHECK_INTERVAL - 1
+					&& (status = check(*control)) != EulerStatus::Found)
+				return status;
+		}
+	}
+	used.assign(targets.size(), 0);
+	cursors.assign(offsets.begin(), offsets.end() - 1);
+	if (control)
+		control->edge_total = (targets.size() + loops) / 2;
+
+	size_t start = parity.odd ? parity.first : 0;
+	size_t cur = start;
+	path_.push_back(verts[start]);
+	for (;;) {
+		// Skip edges already used from the front of this vertex's range
+		size_t& c = cursors[cur];
+		while (c < offsets[cur + 1] && used[c])
+			c++;
+		if (c == offsets[cur + 1])
+			break;
+
+		// Smallest unused neighbor other than the start, else the start
+		size_t k = c;
+		while (k < offsets[cur + 1] && (used[k] || targets[k] == start))
+			k++;
+		if (k == offsets[cur + 1])
+			k = c;
+
+		used[k] = used[twins[k]] = 1;
+		cur = targets[k];
+		path_.push_back(verts[cur]);
+
+		if (control && path_.size() % CHECK_INTERVAL == 0) {
+			control->edges_used.store(path_.size() - 1, std::memory_order_relaxed);
+			if ((status = check(*control)) != EulerStatus::Found)
+				return status;
+		}
+	}
+	if (control)
+		control->edges_used = path_.size() - 1;
+	return status;
+}
+
+/**
+ * @brief Find Euler paths in many graphs in parallel
+ * 
+ * @param graphs The graphs of interest
+ * @return std::vector<std::vector<int> > The path found in each graph, as
+ * find_path() would find it, or an empty vector if it has none
+ * 
+ * Graphs are divided among the shared Scheduler's workers, each subrange
+ * reusing one EulerWorkspace.
+ */
+inline std::vector<std::vector<int> > find_paths(const std::vector<Graph<int> >& graphs) {
+	std::vector<std::vector<int> > paths(graphs.size());
+	parallel_for(0, graphs.size(), [&](size_t lo, size_t hi) {
+		EulerWorkspace ws;
+		for (size_t i = lo; i < hi; i++)
+			paths[i] = ws.find_path(graphs[i]);
+	});
+	return paths;
+}
+
+/**
+ * @brief Result of an asynchronous search for an Euler path
+ */
+struct EulerResult {
+	EulerStatus status;
+	std::vector<int> path; // Complete if found, else the part found so far
+};
+
+/**
+ * @brief Handle to an Euler path search running in the background
+ * 
+ * Dropping the handle does not stop the search; call cancel() first if the
+ * result is no longer wanted.
+ */
+class EulerHandle {
+public:
+	EulerHandle(std::shared_ptr<EulerControl> control,
+		std::future<EulerResult> result, Scheduler& s)
+		: control(std::move(control)), result(std::move(result)), s(&s) { }
+
+	/**
+	 * @brief Ask the search to stop
+	 * 
+	 * The search stops soon after, with status Cancelled, unless it has
+	 * already finished.
+	 */
+	void cancel() { control->cancelled = true; }
+
+	/**
+	 * @brief Determine if the search has finished
+	 * 
+	 * @return true get() will not block
+	 * @return false The search is still running
+	 */
+	bool ready() const
+		{ return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+
+	/**
+	 * @brief Wait for a limited time for the search to finish
+	 * 
+	 * @param timeout Longest time to wait
+	 * @return true The search has finished
+	 * @return false The search is still running
+	 */
+	template <typename Rep, typename Period>
+	bool wait_for(std::chrono::duration<Rep, Period> timeout) const
+		{ return result.wait_for(timeout) == std::future_status::ready; }
+
+	/**
+	 * @brief Wait for the search to finish and take its result
+	 * 
+	 * @return EulerResult The outcome and path; may only be called once
+	 *
+	 * Called from a worker of the scheduler running the search, runs other
+	 * tasks while it waits, since the search may be queued behind it.
+	 */
+	EulerResult get() {
+		if (s->is_worker())
+			while (!ready())
+				if (!s->run_one())
+					std::this_thread::yield();
+		return result.get();
+	}
+
+	/**
+	 * @brief Get number of edges on the path so far
+	 * 
+	 * @return size_t Edges used, updated every few thousand steps
+	 */
+	size_t edges_used() const { return control->edges_used; }
+
+	/**
+	 * @brief Get number of edges in the graph
+	 * 
+	 * @return size_t Edge count, or zero until the search has indexed the
+	 * graph
+	 */
+	size_t edge_total() const { return control->edge_total; }
+
+private:
+	std::shared_ptr<EulerControl> control;
+	std::future<EulerResult> result;
+	Scheduler* s;
+};
+
+/**
+ * @brief Start searching for an Euler path in the background
+ * 
+ * @param g The graph of interest, moved or copied into the search
+ * @param budget Longest the search may run before stopping with status
+ * TimedOut; zero for no limit
+ * @param s Scheduler to run on; the background pool by default, since a
+ * search can run far longer than the tasks of the shared pool
+ * @return EulerHandle Handle for cancelling, watching progress and getting
+ * the result
+ */
+inline EulerHandle find_path_async(Graph<int> g,
+	std::chrono::milliseconds budget = std::chrono::milliseconds(0),
+	Scheduler& s = Scheduler::background()) {
+	auto control = std::make_shared<EulerControl>();
+	if (budget.count())
+		control->deadline = std::chrono::steady_clock::now() + budget;
+
+	class SolveTask : public Task {
+	public:
+		SolveTask(Graph<int> g, std::shared_ptr<EulerControl> control)
+			: g(std::move(g)), control(std::move(control)) { }
+		void run() override {
+			try {
+				EulerWorkspace ws;
+				EulerStatus status = ws.find_path(g, *control);
+				promise.set_value({ status, ws.path() });
+			} catch (...) {
+				promise.set_exception(std::current_exception());
+			}
+		}
+		Graph<int> g;
+		std::shared_ptr<EulerControl> control;
+		std::promise<EulerResult> promise;
+	};
+
+	SolveTask* task = new SolveTask(std::move(g), control);
+	EulerHandle handle(control, task->promise.get_future(), s);
+	s.submit(task);
+	return handle;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "euler.h"
+#include "graph.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Bounded cache of Euler paths keyed by graph fingerprint
+ *
+ * Repeated queries on the same graph are answered by computing its
+ * fingerprint, one pass with no allocation, instead of searching again.
+ * Entries are evicted least recently used first once the memory charged to
+ * the cache would exceed its limit. Each entry is charged for its path plus
+ * a fixed overhead for its bookkeeping. The cache may be shared between
+ * threads.
+ *
+ * Graphs are identified by fingerprint alone, so two different graphs that
+ * collide (probability about 2^-64 per pair) would share an answer.
+ */
+class EulerCache {
+public:
+	using Path = std::shared_ptr<const std::vector<int> >;
+
+	/**
+	 * @brief Create an empty cache
+	 *
+	 * @param max_bytes Most memory that cached paths may be charged for
+	 */
+	explicit EulerCache(size_t max_bytes = 64 << 20) : max_bytes(max_bytes) { }
+
+	/**
+	 * @brief Find an Euler path or circuit, using a cached answer if any
+	 *
+	 * @param g The graph of interest
+	 * @return Path The path as find_path() would find it, or an empty vector
+	 * if the graph has no Euler path
+	 */
+	Path find_path(const Graph<int>& g);
+
+	/**
+	 * @brief Look up a path by fingerprint
+	 *
+	 * @param key Fingerprint of the graph
+	 * @return Path The cached path, or nullptr if none is cached
+	 */
+	Path lookup(uint64_t key);
+
+	/**
+	 * @brief Add a path to the cache
+	 *
+	 * @param key Fingerprint of the graph
+	 * @param path The path; not cached if larger than the whole cache
+	 */
+	void insert(uint64_t key, Path path);
+
+	/**
+	 * @brief Change the memory limit, evicting entries as needed
+	 *
+	 * @param bytes Most memory that cached paths may be charged for
+	 */
+	void set_max_bytes(size_t bytes);
+
+	size_t hits() const { std::lock_guard<std::mutex> lock(mutex); return hits_; }
+	size_t misses() const { std::lock_guard<std::mutex> lock(mutex); return misses_; }
+	size_t bytes() const { std::lock_guard<std::mutex> lock(mutex); return bytes_; }
+	size_t size() const { std::lock_guard<std::mutex> lock(mutex); return index.size(); }
+
+private:
+	struct Entry {
+		uint64_t key;
+		Path path;
+	};
+	static constexpr size_t ENTRY_OVERHEAD = 96; // List node, map node, control block
+
+	mutable std::mutex mutex;
+	std::list<Entry> lru; // Most recently used first
+	std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+	size_t max_bytes;
+	size_t bytes_ = 0;
+	size_t hits_ = 0;
+	size_t misses_ = 0;
+
+	static size_t charge(const Path& p)
+		{ return p->size() * sizeof(int) + ENTRY_OVERHEAD; }
+	void evict(); // Requires mutex
+};
+
+inline EulerCache::Path EulerCache::find_path(const Graph<int>& g) {
+	uint64_t key = g.fingerprint();
+	if (Path p = lookup(key))
+		return p;
+	// Search without holding the lock; a racing thread may do the same
+	EulerWorkspace ws;
+	Path p = std::make_shared<const std::vector<int> >(ws.find_path(g));
+	insert(key, p);
+	return p;
+}
+
+inline EulerCache::Path EulerCache::lookup(uint64_t key) {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = index.find(key);
+	if (it == index.end()) {
+		misses_++;
+		return nullptr;
+	}
+	hits_++;
+	lru.splice(lru.begin(), lru, it->second);
+	return it->second->path;
+}
+
+inline void EulerCache::insert(uint64_t key, Path path) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (charge(path) > max_bytes)
+		return;
+	auto it = index.find(key);
+	if (it != index.end()) {
+		bytes_ -= charge(it->second->path);
+		lru.erase(it->second);
+		index.erase(it);
+	}
+	bytes_ += charge(path);
+	lru.push_front({ key, std::move(path) });
+	index[key] = lru.begin();
+	evict();
+}
+
+inline void EulerCache::set_max_bytes(size_t bytes) {
+	std::lock_guard<std::mutex> lock(mutex);
+	max_bytes = bytes;
+	evict();
+}
+
+inline void EulerCache::evict() {
+	while (bytes_ > max_bytes) {
+		bytes_ -= charge(lru.back().path);
+		index.erase(lru.back().key);
+		lru.pop_back();
+	}
+}
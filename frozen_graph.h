@@ -0,0 +1,318 @@
+#pragma once
+
+#include "degree_parity.h"
+#include "graph.h"
+#include "page_array.h"
+#include "scheduler.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief A contiguous range of vertex indices
+ *
+ * Used for the targets of a vertex's edges in a FrozenGraph.
+ */
+struct IndexRange {
+	const size_t* first;
+	const size_t* last;
+	const size_t* begin() const { return first; }
+	const size_t* end() const { return last; }
+	size_t size() const { return last - first; }
+	bool empty() const { return first == last; }
+};
+
+namespace frozen_detail {
+	// Copy one array into another of the same size in chunks of 1 MB
+	template <typename U>
+	void copy(PageArray<U>& to, const PageArray<U>& from, Scheduler& s) {
+		const size_t chunk = std::max<size_t>(1, (1 << 20) / sizeof(U));
+		parallel_for(0, (from.size() + chunk - 1) / chunk, [&](size_t lo, size_t hi) {
+			size_t end = std::min(from.size(), hi * chunk);
+			std::memcpy(to.data() + lo * chunk, from.data() + lo * chunk,
+				(end - lo * chunk) * sizeof(U));
+		}, 1, s);
+	}
+}
+
+/**
+ * @brief An immutable snapshot of a graph in compressed sparse row form
+ *
+ * @tparam T Data type of vertices, which must be trivially copyable
+ *
+ * Vertices are numbered 0 to vertex_count() - 1 in ascending order of their
+ * values. The edges leaving vertex i are numbered offset(i) through
+ * offset(i + 1) - 1, sorted by target, and each edge stores the index of its
+ * target vertex and its weight. All four arrays are allocated according to
+ * an AllocPolicy, so large snapshots can use huge pages or be spread across
+ * NUMA nodes.
+ *
+ * Frozen graphs answer the same queries as DiGraph, but neighbor scans touch
+ * only contiguous memory.
+ */
+template <typename T>
+class FrozenGraph {
+public:
+	static constexpr size_t npos = (size_t) -1;
+
+	FrozenGraph() = default;
+
+	/**
+	 * @brief Take a snapshot of a graph
+	 *
+	 * @param g The graph to be copied
+	 * @param policy How the snapshot's arrays are allocated
+	 * @param s Scheduler on which to fill the edge arrays in parallel, split
+	 * by edge count, or nullptr to fill them on the calling thread
+	 */
+	explicit FrozenGraph(const DiGraph<T>& g,
+		AllocPolicy policy = AllocPolicy::Default, Scheduler* s = nullptr);
+
+	/**
+	 * @brief Copy the snapshot
+	 *
+	 * @param policy How the copy's arrays are allocated
+	 * @param s Scheduler to run on
+	 * @return FrozenGraph<T> An identical snapshot
+	 *
+	 * Each array is copied with memcpy in chunks spread over the scheduler's
+	 * workers, which also places the pages of the copy near the threads that
+	 * touched them first.
+	 */
+	FrozenGraph clone(AllocPolicy policy = AllocPolicy::Default,
+		Scheduler& s = Scheduler::instance()) const;
+
+	/**
+	 * @brief Get number of vertices
+	 *
+	 * @return size_t Number of vertices
+	 */
+	size_t vertex_count() const { return verts.size(); }
+
+	/**
+	 * @brief Get number of edges
+	 *
+	 * @return size_t Number of edges; an undirected edge counts twice
+	 */
+	size_t edge_count() const { return targets.size(); }
+
+	/**
+	 * @brief Get a vertex by index
+	 *
+	 * @param i Index of the vertex
+	 * @return const T& The vertex
+	 */
+	const T& vertex(size_t i) const { return verts[i]; }
+
+	/**
+	 * @brief Find the index of a vertex
+	 *
+	 * @param v The vertex of interest
+	 * @return size_t Index of v, or npos if v does not exist
+	 */
+	size_t index_of(const T& v) const;
+
+	/**
+	 * @brief Get position of a vertex's first edge
+	 *
+	 * @param i Index of the vertex; vertex_count() gives edge_count()
+	 * @return size_t Number of the first edge leaving vertex i
+	 */
+	size_t offset(size_t i) const { return offsets[i]; }
+
+	/**
+	 * @brief Find the vertex at which an edge begins
+	 *
+	 * @param k Number of the edge
+	 * @return size_t Index of the vertex whose edges include edge k
+	 */
+	size_t edge_source(size_t k) const
+		{ return std::upper_bound(offsets.begin(), offsets.end(), k) - offsets.begin() - 1; }
+
+	/**
+	 * @brief Get outward degree of vertex
+	 *
+	 * @param i Index of the vertex
+	 * @return size_t Number of outward edges
+	 */
+	size_t degree_out(size_t i) const { return offsets[i + 1] - offsets[i]; }
+
+	/**
+	 * @brief Find the vertices of odd degree
+	 *
+	 * @param kernel Instruction set to use
+	 * @return DegreeParity Count of odd vertices and the indices of the first
+	 * two, found in one vectorized pass over the offsets
+	 */
+	DegreeParity degree_parity(ParityKernel kernel = ParityKernel::Auto) const
+		{ return ::degree_parity(offsets.data(), vertex_count(), kernel); }
+
+	/**
+	 * @brief Get targets of a vertex's edges
+	 *
+	 * @param i Index of the vertex
+	 * @return IndexRange Indices of the vertices reached by a single outgoing
+	 * edge, in ascending order
+	 */
+	IndexRange neighbors(size_t i) const
+		{ return { targets.data() + offsets[i], targets.data() + offsets[i + 1] }; }
+
+	/**
+	 * @brief Get the target of an edge
+	 *
+	 * @param k Number of the edge
+	 * @return size_t Index of the vertex at which the edge ends
+	 */
+	size_t target(size_t k) const { return targets[k]; }
+
+	/**
+	 * @brief Get the weight of an edge
+	 *
+	 * @param k Number of the edge
+	 * @return size_t Weight of the edge
+	 */
+	size_t edge_weight(size_t k) const { return weights[k]; }
+
+	/**
+	 * @brief Find an edge from one vertex to another
+	 *
+	 * @param i Index of the vertex at which the edge begins
+	 * @param j Index of the vertex at which the edge ends
+	 * @return size_t Number of the edge, or npos if there is none
+	 */
+	size_t find_edge(size_t i, size_t j) const;
+
+	/**
+	 * @brief Determine if edge exists from one vertex to another
+	 *
+	 * @param v1 The vertex of interest to begin an edge
+	 * @param v2 The vertex of interest to end an edge
+	 * @return true An edge exists from v1 to v2
+	 * @return false No edge exists from v1 to v2
+	 */
+	bool is_edge(const T& v1, const T& v2) const;
+
+	/**
+	 * @brief Get weight of a edge
+	 *
+	 * @param v1 Vertex at which edge begins
+	 * @param v2 Vertex at which edge ends
+	 * @return size_t Weight of the edge, or zero if there is no such edge
+	 */
+	size_t weight(const T& v1, const T& v2) const;
+
+	/**
+	 * @brief Start loading a vertex's edge positions into cache
+	 *
+	 * @param i Index of the vertex
+	 */
+	void prefetch_offsets(size_t i) const { __builtin_prefetch(&offsets[i]); }
+
+	/**
+	 * @brief Start loading the targets of a vertex's edges into cache
+	 *
+	 * @param i Index of the vertex, whose offsets should already be cached
+	 *
+	 * Only the first cache line of targets is requested; longer lists are
+	 * read sequentially and are handled well by the hardware prefetcher.
+	 */
+	void prefetch_targets(size_t i) const
+		{ __builtin_prefetch(targets.data() + offsets[i]); }
+
+	/**
+	 * @brief Determine if the snapshot is backed by huge pages
+	 *
+	 * @return true Huge pages were requested and granted
+	 * @return false Ordinary pages are used
+	 */
+	bool huge_pages() const { return targets.huge(); }
+
+private:
+	PageArray<T> verts;        // Vertices in ascending order
+	PageArray<size_t> offsets; // vertex_count() + 1 edge positions
+	PageArray<size_t> targets; // Index of the vertex each edge ends at
+	PageArray<size_t> weights; // Weight of each edge
+};
+
+template <typename T>
+FrozenGraph<T>::FrozenGraph(const DiGraph<T>& g, AllocPolicy policy, Scheduler* s) {
+	std::vector<NeighborView<T> > lists;
+	size_t m = 0;
+	VertexView<T> vv = g.vertex_view();
+	lists.reserve(vv.size());
+	for (auto it = vv.begin(); it != vv.end(); ++it) {
+		lists.push_back(it.neighbors());
+		m += lists.back().size();
+	}
+	size_t n = lists.size();
+	verts = PageArray<T>(n, policy);
+	offsets = PageArray<size_t>(n + 1, policy);
+	targets = PageArray<size_t>(m, policy);
+	weights = PageArray<size_t>(m, policy);
+
+	size_t i = 0, k = 0;
+	for (auto it = vv.begin(); it != vv.end(); ++it, ++i) {
+		verts[i] = *it;
+		offsets[i] = k;
+		k += lists[i].size();
+	}
+	offsets[n] = k;
+
+	// Targets are found by binary search over verts, so vertices can be
+	// filled independently
+	auto fill = [&](size_t lo, size_t hi) {
+		for (size_t i = lo; i < hi; i++) {
+			size_t k = offsets[i];
+			for (auto it = lists[i].begin(); it != lists[i].end(); ++it, ++k) {
+				targets[k] = index_of(*it);
+				weights[k] = it.weight();
+			}
+		}
+	};
+	if (s)
+		parallel_for_weighted(0, n, [&](size_t i) { return offsets[i] + i; },
+			fill, 0, *s);
+	else
+		fill(0, n);
+}
+
+template <typename T>
+FrozenGraph<T> FrozenGraph<T>::clone(AllocPolicy policy, Scheduler& s) const {
+	FrozenGraph<T> c;
+	c.verts = PageArray<T>(verts.size(), policy);
+	c.offsets = PageArray<size_t>(offsets.size(), policy);
+	c.targets = PageArray<size_t>(targets.size(), policy);
+	c.weights = PageArray<size_t>(weights.size(), policy);
+	frozen_detail::copy(c.verts, verts, s);
+	frozen_detail::copy(c.offsets, offsets, s);
+	frozen_detail::copy(c.targets, targets, s);
+	frozen_detail::copy(c.weights, weights, s);
+	return c;
+}
+
+template <typename T>
+size_t FrozenGraph<T>::index_of(const T& v) const {
+	const T* it = std::lower_bound(verts.begin(), verts.end(), v);
+	return it != verts.end() && !(v < *it) ? it - verts.begin() : npos;
+}
+
+template <typename T>
+size_t FrozenGraph<T>::find_edge(size_t i, size_t j) const {
+	IndexRange r = neighbors(i);
+	const size_t* it = std::lower_bound(r.begin(), r.end(), j);
+	return it != r.end() && *it == j ? it - targets.data() : npos;
+}
+
+template <typename T>
+bool FrozenGraph<T>::is_edge(const T& v1, const T& v2) const {
+	size_t i = index_of(v1), j = index_of(v2);
+	return i != npos && j != npos && find_edge(i, j) != npos;
+}
+
+template <typename T>
+size_t FrozenGraph<T>::weight(const T& v1, const T& v2) const {
+	size_t i = index_of(v1), j = index_of(v2);
+	size_t k = i != npos && j != npos ? find_edge(i, j) : npos;
+	return k != npos ? weights[k] : 0;
+}
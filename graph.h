@@ -1,9 +1,228 @@
 #pragma once
  
+#include "edge_filter.h"
+#include "scheduler.h"
+#include "small_adjacency.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <list>
 #include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
  
+/**
+ * @brief A read-only range over the outward neighbors of one vertex
+ * 
+ * @tparam T Data type of vertices
+ * 
+ * Iterators dereference to the neighboring vertex; the weight of the edge
+ * to that neighbor is available through the iterator's weight() method.
+ */
+template <typename T>
+class NeighborView {
+public:
+	class iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+		iterator() = default;
+		explicit iterator(typename SmallAdjacency<T>::const_iterator it)
+			: it(it) { }
+		const T& operator* () const { return it->first; }
+		const T* operator-> () const { return &it->first; }
+		size_t weight() const { return it->second; }
+		iterator& operator++ () { ++it; return *this; }
+		iterator operator++ (int) { iterator old = *this; ++it; return old; }
+		bool operator== (const iterator& o) const { return it == o.it; }
+		bool operator!= (const iterator& o) const { return it != o.it; }
+	private:
+		typename SmallAdjacency<T>::const_iterator it;
+	};
+
+	explicit NeighborView(const SmallAdjacency<T>& m) : m(&m) { }
+	iterator begin() const { return iterator(m->begin()); }
+	iterator end() const { return iterator(m->end()); }
+	size_t size() const { return m->size(); }
+	bool empty() const { return m->empty(); }
+private:
+	const SmallAdjacency<T>* m;
+};
+
+/**
+ * @brief A read-only range over the vertices of a graph
+ * 
+ * @tparam T Data type of vertices
+ */
+template <typename T>
+class VertexView {
+public:
+	class iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+		iterator() = default;
+		explicit iterator(typename std::map<T, SmallAdjacency<T> >::const_iterator it)
+			: it(it) { }
+		const T& operator* () const { return it->first; }
+		const T* operator-> () const { return &it->first; }
+		NeighborView<T> neighbors() const { return NeighborView<T>(it->second); }
+		iterator& operator++ () { ++it; return *this; }
+		iterator operator++ (int) { iterator old = *this; ++it; return old; }
+		bool operator== (const iterator& o) const { return it == o.it; }
+		bool operator!= (const iterator& o) const { return it != o.it; }
+	private:
+		typename std::map<T, SmallAdjacency<T> >::const_iterator it;
+	};
+
+	explicit VertexView(const std::map<T, SmallAdjacency<T> >& m) : m(&m) { }
+	iterator begin() const { return iterator(m->begin()); }
+	iterator end() const { return iterator(m->end()); }
+	size_t size() const { return m->size(); }
+	bool empty() const { return m->empty(); }
+private:
+	const std::map<T, SmallAdjacency<T> >* m;
+};
+
+/**
+ * @brief An edge of a graph, as yielded by EdgeView
+ * 
+ * @tparam T Data type of vertices
+ * 
+ * The vertices refer into the graph, so an edge is valid only as long as
+ * the view it came from. Supports structured bindings, as in
+ * for (auto [v1, v2, w] : g.edge_view()).
+ */
+template <typename T>
+struct EdgeRef {
+	const T& src;
+	const T& dst;
+	size_t weight;
+};
+
+/**
+ * @brief A read-only range over every edge of a graph
+ * 
+ * @tparam T Data type of vertices
+ * 
+ * Edges come in ascending order of source and then of target, read
+ * directly from each vertex's adjacency without looking vertices up. The
+ * view is invalidated when vertices or edges are added or removed.
+ */
+template <typename T>
+class EdgeView {
+	using Outer = typename std::map<T, SmallAdjacency<T> >::const_iterator;
+	using Inner = typename SmallAdjacency<T>::const_iterator;
+public:
+	class iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = EdgeRef<T>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = EdgeRef<T>;
+
+		iterator() = default;
+		iterator(Outer v, Outer end) : v(v), end(end) {
+			if (v != end)
+				q = v->second.begin();
+			skip();
+		}
+		EdgeRef<T> operator* () const { return { v->first, q->first, q->second }; }
+		iterator& operator++ () { ++q; skip(); return *this; }
+		iterator operator++ (int) { iterator old = *this; ++*this; return old; }
+		bool operator== (const iterator& o) const
+			{ return v == o.v && (v == end || q == o.q); }
+		bool operator!= (const iterator& o) const { return !(*this == o); }
+	private:
+		Outer v, end;
+		Inner q;
+
+		// Move past vertices whose edges are used up
+		void skip() {
+			while (v != end && q == v->second.end())
+				if (++v != end)
+					q = v->second.begin();
+		}
+	};
+
+	explicit EdgeView(const std::map<T, SmallAdjacency<T> >& m) : m(&m) { }
+	iterator begin() const { return iterator(m->begin(), m->end()); }
+	iterator end() const { return iterator(m->end(), m->end()); }
+private:
+	const std::map<T, SmallAdjacency<T> >* m;
+};
+
+/**
+ * @brief Order in which DiGraph::compact() numbers the vertices
+ * 
+ * Ascending      Same order as the old numbers
+ * BreadthFirst   Order of a breadth-first search from the lowest vertex of
+ *                each component, so neighbors tend to get nearby numbers
+ *                and arrays indexed by vertex are read with better locality
+ */
+enum class VertexOrder { Ascending, BreadthFirst };
+
+/**
+ * @brief Receives each change made to a graph
+ * 
+ * @tparam T Data type of vertices
+ * 
+ * Attached to a DiGraph with set_listener(), it is called after every
+ * public change, in order, with the arguments given to that change. Changes
+ * to an undirected Graph arrive as the pair of directed changes made to
+ * its edges.
+ */
+template <typename T>
+class GraphListener {
+public:
+	virtual ~GraphListener() = default;
+	virtual void vertex_added(const T& v) = 0;
+	virtual void vertex_removed(const T& v) = 0;
+	virtual void edge_updated(const T& v1, const T& v2, size_t w) = 0;
+	virtual void edge_removed(const T& v1, const T& v2) = 0;
+	// One call for the whole of DiGraph::compact(), with its arguments and
+	// the old and new number of each vertex
+	virtual void compacted(VertexOrder order, const T& first,
+		const std::vector<std::pair<T, T> >& mapping) = 0;
+};
+
+namespace graph_detail {
+	// Listener pointer that copies of a graph do not inherit
+	template <typename T>
+	struct ListenerLink {
+		GraphListener<T>* p = nullptr;
+		ListenerLink() = default;
+		ListenerLink(const ListenerLink&) { }
+		ListenerLink& operator= (const ListenerLink&) { return *this; }
+	};
+
+	// Finalizer from splitmix64; spreads every input bit over the output
+	inline uint64_t mix(uint64_t x) {
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ULL;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebULL;
+		return x ^ (x >> 31);
+	}
+
+	// Whether std::hash is defined for T, as the edge filter needs
+	template <typename T>
+	using hashable = std::is_default_constructible<std::hash<T> >;
+}
+
 /**
  * @brief A directed graph, optionally weighted
  * 
@@ -12,7 +231,9 @@
 template <typename T>
 class DiGraph {
 private:
-	std::map<T, std::map<T, size_t> > adj;
+	std::map<T, SmallAdjacency<T> > adj;
+	graph_detail::ListenerLink<T> listener;
+	EdgeFilter filter;
 public:
 	/**
 	 * @brief Add an edge to the graph
@@ -25,8 +246,26 @@ public:
 	 * not already defined as edges, they are created automatically. For
 	 * unweighted graphs, omit parameter w.
 	 */
-	void add_edge(const T& v1, const T& v2, size_t w = 1)
-		{ if (!is_edge(v1, v2)) update_edge(v1, v2, w); }
+	void add_edge(const T& v1, const T& v2, size_t w = 1) { try_add_edge(v1, v2, w); }
+ 
+	/**
+	 * @brief Add an edge to the graph if it is absent
+	 * 
+	 * @param v1 Vertex at which edge begins
+	 * @param v2 Vertex at which edge ends
+	 * @param w Weight of the edge (optional)
+	 * @return true The edge was added
+	 * @return false The edge already existed, and is unchanged
+	 * 
+	 * Like add_edge(), but looks up each vertex only once.
+	 */
+	bool try_add_edge(const T& v1, const T& v2, size_t w = 1) {
+		if (!insert_edge(v1, v2, w).second)
+			return false;
+		if (listener.p)
+			listener.p->edge_updated(v1, v2, w);
+		return true;
+	}
  
 	/**
 	 * @brief Adds a vertext to the graph
@@ -37,7 +276,8 @@ public:
 	 * a vertex. The vertex, if added, will have no outgoing or incoming
 	 * edges.
 	 */
-	void add_vertex(const T& v) { adj[v]; }
+	void add_vertex(const T& v)
+		{ adj[v]; if (listener.p) listener.p->vertex_added(v); }
  
 	/**
 	 * @brief Get inward degree of vertex
@@ -55,6 +295,32 @@ public:
 	 */
 	size_t degree_out(const T& v) const { return adj.at(v).size(); }
  
+	/**
+	 * @brief Copy the graph using several threads
+	 * 
+	 * @param s Scheduler to run on
+	 * @return DiGraph<T> A copy equal to this graph, with the same edge
+	 * filter and no listener
+	 * 
+	 * The vertices are inserted serially, in order, with empty neighbor
+	 * lists; the neighbor lists are then copied in parallel, split by edge
+	 * count. Worthwhile for large graphs with many high-degree vertices,
+	 * whose neighbor lists live on the heap.
+	 */
+	DiGraph<T> clone(Scheduler& s = Scheduler::instance()) const;
+ 
+	/**
+	 * @brief Compute a structural hash of the graph
+	 * 
+	 * @return uint64_t Hash of the vertex set, edge set and weights
+	 * 
+	 * Computed in one pass as a sum of independently mixed hashes of each
+	 * vertex and each edge, so it does not depend on the order in which
+	 * vertices and edges were added. Equal graphs always have equal
+	 * fingerprints; different graphs collide with probability about 2^-64.
+	 */
+	uint64_t fingerprint() const;
+ 
 	/**
 	 * @brief Determine if edge exists from one vertex to another
 	 * 
@@ -63,8 +329,40 @@ public:
 	 * @return true An edge exists from v1 to v2
 	 * @return false No edge exists from v1 to v2
 	 */
-	bool is_edge(const T& v1, const T& v2) const
-		{ return is_vertex(v1) && adj.at(v1).find(v2) != adj.at(v1).end(); }
+	bool is_edge(const T& v1, const T& v2) const { return find_edge(v1, v2) != nullptr; }
+ 
+	/**
+	 * @brief Find an edge from one vertex to another
+	 * 
+	 * @param v1 The vertex of interest to begin an edge
+	 * @param v2 The vertex of interest to end an edge
+	 * @return const size_t* Weight of the edge from v1 to v2, or nullptr if
+	 * there is no such edge
+	 * 
+	 * Looks up v1 once and searches its neighbors once. The pointer is
+	 * invalidated by any change to the edges leaving v1.
+	 */
+	const size_t* find_edge(const T& v1, const T& v2) const {
+		if (filter.enabled() && !filter.may_contain(edge_hash(v1, v2)))
+			return nullptr;
+		auto it = adj.find(v1);
+		if (it == adj.end())
+			return nullptr;
+		auto q = it->second.find(v2);
+		return q != it->second.end() ? &q->second : nullptr;
+	}
+ 
+	/**
+	 * @brief Determine if many edges exist
+	 * 
+	 * @param probes Pairs of vertices at which each edge begins and ends
+	 * @return std::vector<bool> Whether each edge exists, in the order of
+	 * probes
+	 * 
+	 * Probes are answered in order of source vertex, so each source is
+	 * looked up once and its neighbors are searched in one forward sweep.
+	 */
+	std::vector<bool> is_edge(const std::vector<std::pair<T, T> >& probes) const;
  
 
 	/**
@@ -100,6 +398,19 @@ public:
 	 */
     std::list<T> neighbors_in (const T& v) const;
  
+	/**
+	 * @brief View the neighbors of a given vertex without copying
+	 * 
+	 * @param v The vertex of interest
+	 * @return NeighborView<T> Range of vertices connected by a single outgoing
+	 * edge, in ascending order
+	 * 
+	 * Unlike neighbors(), this does not allocate. The view is invalidated by
+	 * any change to the edges leaving v. If vertex v does not exist, the view
+	 * is empty.
+	 */
+	NeighborView<T> neighbor_view(const T& v) const;
+ 
 	/**
 	 * @brief Remove a vertex from the graph
 	 * 
@@ -120,7 +431,50 @@ public:
 	 * Removes the edge extending from vertex v1 to vertex v2. If the edge
 	 * does not exist, or if either v1 or v2 does not exist, does nothing.
 	 */
-    void remove_edge (const T& v1, const T& v2) { adj[v1].erase(v2); }
+    void remove_edge (const T& v1, const T& v2) {
+		if (adj[v1].erase(v2) && filter.enabled())
+			filter.erase(edge_hash(v1, v2));
+		if (listener.p)
+			listener.p->edge_removed(v1, v2);
+	}
+ 
+	/**
+	 * @brief Attach a listener to be told of each change to the graph
+	 * 
+	 * @param l The listener, or nullptr to detach the current one
+	 * 
+	 * The listener must outlive the graph or be detached first. Copies of
+	 * the graph, including those made by moving it, start with no listener.
+	 */
+	void set_listener(GraphListener<T>* l) { listener.p = l; }
+ 
+	/**
+	 * @brief Keep a filter that answers most lookups of missing edges
+	 * 
+	 * Builds a counting Bloom filter (see edge_filter.h) over the current
+	 * edges. From then on, is_edge() and weight() for an edge the filter
+	 * rules out return without searching the adjacency, and the filter is
+	 * updated as edges are added and removed, and rebuilt larger when the
+	 * graph has doubled in size since it was built. It costs 8 to 16 bytes
+	 * per edge. Calling this again rebuilds the filter. Requires std::hash
+	 * for T; graphs without a filter never hash their vertices.
+	 */
+	void enable_edge_filter() {
+		static_assert(graph_detail::hashable<T>::value,
+			"enable_edge_filter requires std::hash<T>");
+		build_edge_filter();
+	}
+ 
+	/**
+	 * @brief Drop the filter kept by enable_edge_filter()
+	 */
+	void disable_edge_filter() { filter = EdgeFilter(); }
+ 
+	/**
+	 * @brief Get the edge filter, which is disabled unless
+	 * enable_edge_filter() has been called
+	 */
+	const EdgeFilter& edge_filter() const { return filter; }
  
 	/**
 	 * @brief Updates weight of an edge
@@ -133,8 +487,11 @@ public:
 	 * exists from v1 to v2, or if either v1 or v2 does not exist, the edge
 	 * is added with the given weight.
 	 */
-	void update_edge(const T& v1, const T& v2, size_t w)
-		{ add_vertex(v2);  adj[v1][v2] = w; }
+	void update_edge(const T& v1, const T& v2, size_t w) {
+		*insert_edge(v1, v2, w).first = w;
+		if (listener.p)
+			listener.p->edge_updated(v1, v2, w);
+	}
  
 	/**
 	 * @brief Get list of vertices in the graph
@@ -143,6 +500,29 @@ public:
 	 */
 	std::list<T> vertices() const;
  
+	/**
+	 * @brief View the vertices in the graph without copying
+	 * 
+	 * @return VertexView<T> Range of vertices in ascending order
+	 * 
+	 * Unlike vertices(), this does not allocate. The view is invalidated when
+	 * vertices are added or removed.
+	 */
+	VertexView<T> vertex_view() const { return VertexView<T>(adj); }
+ 
+	/**
+	 * @brief View every edge in the graph without copying
+	 * 
+	 * @return EdgeView<T> Range of (source, target, weight) edges in
+	 * ascending order of source and then of target
+	 * 
+	 * Does not allocate, and reads each vertex's adjacency once rather than
+	 * looking up each edge. The view is invalidated when vertices or edges
+	 * are added or removed. For an undirected Graph, each edge appears once
+	 * in each direction.
+	 */
+	EdgeView<T> edge_view() const { return EdgeView<T>(adj); }
+ 
 	/**
 	 * @brief Get weight of a edge
 	 * 
@@ -154,7 +534,75 @@ public:
 	 * does not exist, or if either v1 or v2 does not exist, returns zero.
 	 */
     size_t weight (const T& v1, const T& v2) const
-		{ return is_vertex(v1) && is_edge(v1, v2) ? adj.at(v1).at(v2) : 0; }
+		{ const size_t* p = find_edge(v1, v2); return p ? *p : 0; }
+ 
+	/**
+	 * @brief Get weights of many edges
+	 * 
+	 * @param probes Pairs of vertices at which each edge begins and ends
+	 * @return std::vector<size_t> Weight of each edge, or zero if it does
+	 * not exist, in the order of probes
+	 * 
+	 * Answered in the same way as the batched is_edge().
+	 */
+	std::vector<size_t> weight(const std::vector<std::pair<T, T> >& probes) const;
+ 
+	/**
+	 * @brief Renumber the vertices densely
+	 * 
+	 * @param order Order in which to number the vertices
+	 * @param first Number given to the first vertex; the default of 1 keeps
+	 * vertex 0 free, as find_path() requires
+	 * @return std::vector<std::pair<T, T> > Old and new number of each
+	 * vertex, sorted by old number, so a vertex's new number can be found by
+	 * binary search
+	 * 
+	 * After many vertices are removed, numbers the survivors first, first
+	 * + 1, and so on, so arrays indexed by vertex need no more room than
+	 * there are vertices. Edges and weights are kept. Each neighbor list is
+	 * rewritten once and freed as soon as its replacement is built. Old
+	 * numbers are resolved through a table indexed by number, or by binary
+	 * search if they span more than 16 times as many numbers as there are
+	 * vertices. Requires integer vertices.
+	 * 
+	 * An edge filter is rebuilt. A listener gets one compacted() call with
+	 * the mapping, so a replica can run the same compaction itself rather
+	 * than replay every vertex and edge.
+	 */
+	std::vector<std::pair<T, T> > compact(VertexOrder order = VertexOrder::Ascending,
+		T first = 1);
+
+private:
+	// Only called while the filter is enabled, which needs std::hash
+	static uint64_t edge_hash(const T& v1, const T& v2) {
+		if constexpr (graph_detail::hashable<T>::value) {
+			std::hash<T> h;
+			return graph_detail::mix(graph_detail::mix(h(v1)) + h(v2));
+		} else {
+			(void) v1;
+			(void) v2;
+			return 0;
+		}
+	}
+
+	void build_edge_filter();
+
+	// Add the edge with weight w if absent, creating its vertices; return
+	// its weight and whether it was added
+	std::pair<size_t*, bool> insert_edge(const T& v1, const T& v2, size_t w) {
+		adj[v2];
+		std::pair<size_t*, bool> r = adj[v1].try_emplace(v2, w);
+		if (r.second && filter.enabled()) {
+			filter.insert(edge_hash(v1, v2));
+			if (filter.crowded())
+				build_edge_filter();
+		}
+		return r;
+	}
+
+	// Call found(i, w) for each probe i that is an edge, with its weight
+	template <typename F>
+	void probe(const std::vector<std::pair<T, T> >& probes, F found) const;
 };
  
 /**
@@ -182,6 +630,20 @@ public:
         DiGraph<T>::add_edge(v2, v1, w);
     }
 
+	/**
+	 * @brief Add an edge to the graph if it is absent
+	 * 
+	 * @param v1 Vertex at one end of the edge
+	 * @param v2 Vertex at other end of the edge
+	 * @param w Weight of the edge (optional)
+	 * @return true The edge was added
+	 * @return false The edge already existed, and is unchanged
+	 */
+    bool try_add_edge (const T& v1, const T& v2, size_t w=1) {
+        bool added = DiGraph<T>::try_add_edge(v1, v2, w);
+        return DiGraph<T>::try_add_edge(v2, v1, w) || added;
+    }
+
 	/**
 	 * @brief Get degree of vertex
 	 * 
@@ -190,6 +652,18 @@ public:
 	 */
     size_t degree (const T& v) const { return DiGraph<T>::degree_out(v); }
 
+	/**
+	 * @brief Copy the graph using several threads
+	 * 
+	 * @param s Scheduler to run on
+	 * @return Graph<T> A copy equal to this graph, made as by DiGraph::clone()
+	 */
+    Graph<T> clone (Scheduler& s = Scheduler::instance()) const {
+        Graph<T> c;
+        static_cast<DiGraph<T>&>(c) = DiGraph<T>::clone(s);
+        return c;
+    }
+
 	/**
 	 * @brief Remove an edge from the graph
 	 * 
@@ -241,6 +715,202 @@ std::list<T> DiGraph<T>::neighbors_in(const T& v) const {
 	return l;
 }
 
+template <typename T>
+DiGraph<T> DiGraph<T>::clone(Scheduler& s) const {
+	DiGraph<T> c;
+	std::vector<std::pair<const SmallAdjacency<T>*, SmallAdjacency<T>*> > lists;
+	std::vector<size_t> prefix(1, 0);
+	lists.reserve(adj.size());
+	prefix.reserve(adj.size() + 1);
+	for (const auto& p : adj) {
+		auto it = c.adj.emplace_hint(c.adj.end(), p.first, SmallAdjacency<T>());
+		lists.emplace_back(&p.second, &it->second);
+		prefix.push_back(prefix.back() + 1 + p.second.size());
+	}
+	parallel_for_weighted(0, lists.size(), [&](size_t i) { return prefix[i]; },
+		[&](size_t lo, size_t hi) {
+			for (size_t i = lo; i < hi; i++)
+				*lists[i].second = *lists[i].first;
+		}, 0, s);
+	c.filter = filter;
+	return c;
+}
+
+template <typename T>
+std::vector<std::pair<T, T> > DiGraph<T>::compact(VertexOrder order, T first) {
+	static_assert(std::is_integral<T>::value, "compact requires integer vertices");
+	using Node = typename std::map<T, SmallAdjacency<T> >::iterator;
+	size_t n = adj.size(), m = 0;
+	std::vector<Node> old;
+	std::vector<T> keys;
+	old.reserve(n);
+	keys.reserve(n);
+	for (Node it = adj.begin(); it != adj.end(); ++it) {
+		old.push_back(it);
+		keys.push_back(it->first);
+		m += it->second.size();
+	}
+
+	if (!n)
+		return {};
+
+	// Old numbers are resolved through a table unless they are very sparse
+	// (compared before adding one, which could wrap for a full-range key set)
+	uint64_t low = (uint64_t) keys.front();
+	uint64_t range = (uint64_t) keys.back() - low;
+	std::vector<size_t> table;
+	if (range < 16 * (uint64_t) n) {
+		table.resize(range + 1);
+		for (size_t i = 0; i < n; i++)
+			table[(uint64_t) keys[i] - low] = i;
+	}
+
+	// Edges by index of old vertex, found once
+	std::vector<size_t> offsets(n + 1), targets;
+	targets.reserve(m);
+	for (size_t i = 0; i < n; i++) {
+		offsets[i] = targets.size();
+		for (const auto& q : old[i]->second)
+			targets.push_back(table.empty()
+				? std::lower_bound(keys.begin(), keys.end(), q.first) - keys.begin()
+				: table[(uint64_t) q.first - low]);
+	}
+	offsets[n] = m;
+	table = std::vector<size_t>();
+
+	// by_rank lists old indices in new order
+	std::vector<size_t> by_rank(n);
+	if (order == VertexOrder::Ascending) {
+		for (size_t i = 0; i < n; i++)
+			by_rank[i] = i;
+	} else {
+		std::vector<char> seen(n);
+		size_t tail = 0;
+		for (size_t s = 0; s < n; s++) {
+			if (seen[s])
+				continue;
+			seen[s] = 1;
+			size_t head = tail;
+			by_rank[tail++] = s;
+			while (head < tail) {
+				size_t u = by_rank[head++];
+				for (size_t k = offsets[u]; k < offsets[u + 1]; k++)
+					if (!seen[targets[k]]) {
+						seen[targets[k]] = 1;
+						by_rank[tail++] = targets[k];
+					}
+			}
+		}
+	}
+	std::vector<size_t> rank(n);
+	for (size_t r = 0; r < n; r++)
+		rank[by_rank[r]] = r;
+
+	std::vector<std::pair<T, T> > mapping(n);
+	for (size_t i = 0; i < n; i++)
+		mapping[i] = { keys[i], (T) (first + rank[i]) };
+
+	// New numbers are created in ascending order, so each goes at the end
+	std::map<T, SmallAdjacency<T> > fresh;
+	std::vector<std::pair<size_t, size_t> > list;
+	for (size_t r = 0; r < n; r++) {
+		size_t i = by_rank[r];
+		list.clear();
+		size_t k = offsets[i];
+		for (const auto& q : old[i]->second)
+			list.emplace_back(rank[targets[k++]], q.second);
+		if (order != VertexOrder::Ascending)
+			std::sort(list.begin(), list.end());
+		old[i]->second.clear();
+		SmallAdjacency<T>& a = fresh.emplace_hint(fresh.end(), (T) (first + r),
+			SmallAdjacency<T>())->second;
+		for (const auto& p : list)
+			a.try_emplace((T) (first + p.first), p.second);
+	}
+	adj = std::move(fresh);
+	if (filter.enabled())
+		build_edge_filter();
+	if (listener.p)
+		listener.p->compacted(order, first, mapping);
+	return mapping;
+}
+
+template <typename T>
+uint64_t DiGraph<T>::fingerprint() const {
+	using graph_detail::mix;
+	std::hash<T> h;
+	uint64_t sum = 0;
+	for (const auto& p : adj) {
+		uint64_t h1 = mix(h(p.first));
+		sum += mix(h1);
+		for (const auto& q : p.second)
+			sum += mix(h1 ^ mix(mix(h(q.first)) + 0x9e3779b97f4a7c15ULL * (q.second + 1)));
+	}
+	return mix(sum);
+}
+
+template <typename T>
+template <typename F>
+void DiGraph<T>::probe(const std::vector<std::pair<T, T> >& probes, F found) const {
+	std::vector<size_t> order;
+	order.reserve(probes.size());
+	bool filtered = filter.enabled();
+	for (size_t i = 0; i < probes.size(); i++)
+		if (!filtered || filter.may_contain(edge_hash(probes[i].first, probes[i].second)))
+			order.push_back(i);
+	std::sort(order.begin(), order.end(),
+		[&](size_t a, size_t b) { return probes[a] < probes[b]; });
+	for (size_t i = 0; i < order.size(); ) {
+		const T& v1 = probes[order[i]].first;
+		auto it = adj.find(v1);
+		if (it == adj.end()) {
+			while (i < order.size() && !(v1 < probes[order[i]].first))
+				i++;
+			continue;
+		}
+		const SmallAdjacency<T>& m = it->second;
+		auto pos = m.begin();
+		for (; i < order.size() && !(v1 < probes[order[i]].first); i++) {
+			const T& v2 = probes[order[i]].second;
+			pos = m.lower_bound(v2, pos);
+			if (pos != m.end() && !(v2 < pos->first))
+				found(order[i], pos->second);
+		}
+	}
+}
+
+template <typename T>
+void DiGraph<T>::build_edge_filter() {
+	size_t m = 0;
+	for (const auto& p : adj)
+		m += p.second.size();
+	filter = EdgeFilter(std::max<size_t>(2 * m, 1024));
+	for (const auto& p : adj)
+		for (const auto& q : p.second)
+			filter.insert(edge_hash(p.first, q.first));
+}
+
+template <typename T>
+std::vector<bool> DiGraph<T>::is_edge(const std::vector<std::pair<T, T> >& probes) const {
+	std::vector<bool> result(probes.size());
+	probe(probes, [&](size_t i, size_t) { result[i] = true; });
+	return result;
+}
+
+template <typename T>
+std::vector<size_t> DiGraph<T>::weight(const std::vector<std::pair<T, T> >& probes) const {
+	std::vector<size_t> result(probes.size());
+	probe(probes, [&](size_t i, size_t w) { result[i] = w; });
+	return result;
+}
+
+template <typename T>
+NeighborView<T> DiGraph<T>::neighbor_view(const T& v) const {
+	static const SmallAdjacency<T> none;
+	auto it = adj.find(v);
+	return NeighborView<T>(it != adj.end() ? it->second : none);
+}
+
 template <typename T>
 std::list<T> DiGraph<T>::vertices() const {
 	std::list<T> l;
@@ -252,8 +922,14 @@ std::list<T> DiGraph<T>::vertices() const {
 template <typename T>
 void DiGraph<T>::remove (const T& v) {
 	for (auto& p : adj)
-		p.second.erase(v);
-	adj.erase(v);
+		if (p.second.erase(v) && filter.enabled())
+			filter.erase(edge_hash(p.first, v));
+	auto it = adj.find(v);
+	if (it != adj.end() && filter.enabled())
+		for (const auto& q : it->second)
+			filter.erase(edge_hash(v, q.first));
+	if (adj.erase(v) && listener.p)
+		listener.p->vertex_removed(v);
 }
 
 /**
@@ -271,14 +947,13 @@ void DiGraph<T>::remove (const T& v) {
  */
 template <typename T>
 std::ostream& operator<< (std::ostream& os, const DiGraph<T>& g) {
-	std::list<T> vlist = g.vertices();
-	os << "Vertex count: " << vlist.size() << std::endl;
-	for (const auto& v1 : vlist) {
-		os << v1 << ":";
-		for (const auto& v2 : vlist) {
-			if (g.is_edge(v1, v2))
-				os << " " << v2 << "(" << g.weight(v1, v2) << ")";
-		}
+	VertexView<T> vv = g.vertex_view();
+	os << "Vertex count: " << vv.size() << std::endl;
+	for (auto it = vv.begin(); it != vv.end(); ++it) {
+		os << *it << ":";
+		NeighborView<T> nv = it.neighbors();
+		for (auto q = nv.begin(); q != nv.end(); ++q)
+			os << " " << *q << "(" << q.weight() << ")";
 		os << std::endl;
 	}
     return os;
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Where and how the pages of large graph arrays are allocated
+ *
+ * Default         Ordinary pages, placed on the node of the first thread
+ *                 to touch them
+ * HugePages       Transparent huge pages requested with madvise
+ * ExplicitHuge    Reserved 2 MB pages (MAP_HUGETLB), falling back to
+ *                 transparent huge pages if none are reserved
+ * Interleave      Pages spread round-robin across the NUMA nodes the
+ *                 process may use, for arrays shared evenly by threads on
+ *                 every socket
+ *
+ * Interleave uses huge pages as well. On systems without NUMA or without
+ * huge pages, the policies quietly degrade to Default. Arrays smaller than
+ * a huge page gain nothing from any of them, so they always come from the
+ * heap.
+ */
+enum class AllocPolicy { Default, HugePages, ExplicitHuge, Interleave };
+
+/**
+ * @brief A fixed-size array allocated directly from the kernel
+ *
+ * @tparam U Data type of elements, which must be trivially copyable
+ *
+ * Storage for a policy other than Default is mapped with mmap, so that its
+ * placement can be controlled; under Default, or when smaller than a huge
+ * page, it comes from the heap. Elements are zero-initialized. Arrays are
+ * move-only.
+ */
+template <typename U>
+class PageArray {
+	static_assert(std::is_trivially_copyable<U>::value,
+		"PageArray elements must be trivially copyable");
+public:
+	PageArray() = default;
+	PageArray(size_t n, AllocPolicy policy = AllocPolicy::Default);
+	~PageArray() { release(); }
+	PageArray(PageArray&& o) noexcept { swap(o); }
+	PageArray& operator= (PageArray&& o) noexcept { swap(o); return *this; }
+	PageArray(const PageArray&) = delete;
+	PageArray& operator= (const PageArray&) = delete;
+
+	U& operator[] (size_t i) { return data_[i]; }
+	const U& operator[] (size_t i) const { return data_[i]; }
+	U* data() { return data_; }
+	const U* data() const { return data_; }
+	U* begin() { return data_; }
+	U* end() { return data_ + n; }
+	const U* begin() const { return data_; }
+	const U* end() const { return data_ + n; }
+	size_t size() const { return n; }
+
+	/**
+	 * @brief Determine if the array is backed by huge pages
+	 *
+	 * @return true Explicit huge pages were mapped, or transparent huge pages
+	 * were requested
+	 * @return false Ordinary pages are used
+	 */
+	bool huge() const { return huge_; }
+
+	void swap(PageArray& o) noexcept {
+		std::swap(data_, o.data_);
+		std::swap(n, o.n);
+		std::swap(mapped, o.mapped);
+		std::swap(huge_, o.huge_);
+	}
+
+private:
+	U* data_ = nullptr;
+	size_t n = 0;
+	size_t mapped = 0; // Bytes mapped, zero if data_ came from calloc
+	bool huge_ = false;
+
+	void release();
+};
+
+namespace page_array {
+	constexpr size_t HUGE_PAGE = 2 << 20;
+
+	constexpr size_t MAX_NODES = 1024;
+	constexpr size_t MASK_BITS = sizeof(unsigned long) * 8;
+	using NodeMask = unsigned long[MAX_NODES / MASK_BITS];
+
+	/**
+	 * @brief Get the NUMA nodes the process may allocate memory on
+	 *
+	 * @return const std::vector<int>& Node ids in ascending order, which
+	 * need not be consecutive or start at 0; empty if they cannot be found
+	 *
+	 * Asks the kernel for the nodes the process's cpuset allows, falling
+	 * back to the nodes that are online.
+	 */
+	inline const std::vector<int>& numa_node_ids() {
+		static std::vector<int> ids = [] {
+			std::vector<int> ids;
+#ifdef __linux__
+			NodeMask mask = {};
+			if (syscall(SYS_get_mempolicy, nullptr, mask, MAX_NODES, nullptr,
+					MPOL_F_MEMS_ALLOWED) == 0) {
+				for (size_t i = 0; i < MAX_NODES; i++)
+					if (mask[i / MASK_BITS] >> (i % MASK_BITS) & 1)
+						ids.push_back((int) i);
+				if (!ids.empty())
+					return ids;
+			}
+#endif
+			// Format is a list of ranges such as "0-1" or "0,2-3"
+			std::ifstream f("/sys/devices/system/node/online");
+			std::string s;
+			if (f >> s) {
+				size_t pos = 0;
+				while (pos < s.size()) {
+					size_t end = s.find(',', pos);
+					std::string r = s.substr(pos, end - pos);
+					size_t dash = r.find('-');
+					int first = std::stoi(r);
+					int last = dash == std::string::npos ? first : std::stoi(r.substr(dash + 1));
+					for (int i = first; i <= last && i < (int) MAX_NODES; i++)
+						ids.push_back(i);
+					pos = end == std::string::npos ? s.size() : end + 1;
+				}
+			}
+			return ids;
+		}();
+		return ids;
+	}
+
+	/**
+	 * @brief Count NUMA nodes the process may allocate memory on
+	 *
+	 * @return size_t Number of nodes, at least one
+	 */
+	inline size_t numa_nodes() {
+		size_t n = numa_node_ids().size();
+		return n ? n : 1;
+	}
+
+#ifdef __linux__
+	// Apply a memory policy to a range of pages over a set of node ids
+	inline void bind(void* p, size_t bytes, int mode, const std::vector<int>& nodes) {
+		NodeMask mask = {};
+		for (int i : nodes)
+			mask[i / MASK_BITS] |= 1UL << (i % MASK_BITS);
+		syscall(SYS_mbind, p, bytes, mode, mask, MAX_NODES, 0);
+	}
+#endif
+}
+
+template <typename U>
+PageArray<U>::PageArray(size_t n, AllocPolicy policy) : n(n) {
+	size_t bytes = n * sizeof(U);
+#ifdef __linux__
+	if (!bytes)
+		return;
+	if (policy == AllocPolicy::Default || bytes < page_array::HUGE_PAGE) {
+		// calloc maps large blocks afresh, so their pages stay untouched
+		// until first use, as the Default policy needs
+		data_ = (U*) std::calloc(n, sizeof(U));
+		if (!data_)
+			throw std::bad_alloc();
+		return;
+	}
+	size_t len = (bytes + page_array::HUGE_PAGE - 1) / page_array::HUGE_PAGE
+		* page_array::HUGE_PAGE;
+	void* p = MAP_FAILED;
+	if (policy == AllocPolicy::ExplicitHuge) {
+		p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		huge_ = p != MAP_FAILED;
+	}
+	if (p == MAP_FAILED) {
+		// Over-allocate by a huge page so the start can be aligned to one,
+		// then trim the excess
+		size_t extra = len + page_array::HUGE_PAGE;
+		char* raw = (char*) mmap(nullptr, extra, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (raw == MAP_FAILED)
+			throw std::bad_alloc();
+		char* aligned = (char*) (((uintptr_t) raw + page_array::HUGE_PAGE - 1)
+			& ~(uintptr_t) (page_array::HUGE_PAGE - 1));
+		if (aligned > raw)
+			munmap(raw, aligned - raw);
+		if (raw + extra > aligned + len)
+			munmap(aligned + len, raw + extra - (aligned + len));
+		p = aligned;
+		huge_ = madvise(p, len, MADV_HUGEPAGE) == 0;
+	}
+
+	// Placement must be set before the pages are first touched
+	const std::vector<int>& nodes = page_array::numa_node_ids();
+	if (policy == AllocPolicy::Interleave && nodes.size() > 1)
+		page_array::bind(p, len, MPOL_INTERLEAVE, nodes);
+	data_ = (U*) p;
+	mapped = len;
+#else
+	(void) policy;
+	data_ = (U*) std::calloc(n ? n : 1, sizeof(U));
+	if (!data_)
+		throw std::bad_alloc();
+#endif
+}
+
+template <typename U>
+void PageArray<U>::release() {
+#ifdef __linux__
+	if (mapped)
+		munmap(data_, mapped);
+	else
+		std::free(data_);
+#else
+	std::free(data_);
+#endif
+	data_ = nullptr;
+	n = mapped = 0;
+}
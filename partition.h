@@ -0,0 +1,474 @@
+#pragma once
+
+#include "graph.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <queue>
+#include <random>
+#include <tuple>
+#include <vector>
+
+/**
+ * @brief Quality of a split of a graph's vertices into parts
+ */
+struct PartitionQuality {
+	size_t edge_cut; // Total weight of edges whose ends are in different parts
+	double balance;  // Size of the largest part over the mean part size
+};
+
+/**
+ * @brief Measure a partition of an undirected graph
+ *
+ * @param g The graph
+ * @param parts Part of each vertex of g, from 0 to k - 1
+ * @param k Number of parts
+ * @return PartitionQuality Edge cut and balance
+ * @throw std::out_of_range A vertex of g has no part, or its part is not
+ * below k
+ */
+inline PartitionQuality evaluate(const Graph<int>& g, const std::map<int, size_t>& parts, size_t k) {
+	size_t cut = 0;
+	std::vector<size_t> sizes(k);
+	VertexView<int> vv = g.vertex_view();
+	for (auto it = vv.begin(); it != vv.end(); ++it) {
+		size_t part = parts.at(*it);
+		sizes.at(part)++;
+		NeighborView<int> nv = it.neighbors();
+		for (auto q = nv.begin(); q != nv.end(); ++q)
+			if (*it < *q && parts.at(*q) != part)
+				cut += q.weight();
+	}
+	double mean = (double) vv.size() / k;
+	return { cut, vv.empty() ? 1.0 : *std::max_element(sizes.begin(), sizes.end()) / mean };
+}
+
+namespace partition_detail {
+	constexpr size_t npos = (size_t) -1;
+
+	// Weighted graph in compressed sparse row form; every edge is stored at
+	// both ends, and there are no loops
+	struct Csr {
+		std::vector<size_t> xadj;   // Start of each vertex's edges
+		std::vector<size_t> adj;    // Other end of each edge
+		std::vector<size_t> ewgt;   // Weight of each edge
+		std::vector<size_t> vwgt;   // Weight of each vertex
+		size_t size() const { return vwgt.size(); }
+	};
+
+	// Match each vertex with the unmatched neighbor joined by the heaviest
+	// edge, and merge the pairs
+	inline Csr coarsen(const Csr& g, std::mt19937& rng, std::vector<size_t>& cmap) {
+		size_t n = g.size();
+		std::vector<size_t> order(n), match(n, npos);
+		for (size_t v = 0; v < n; v++)
+			order[v] = v;
+		std::shuffle(order.begin(), order.end(), rng);
+		for (size_t v : order) {
+			if (match[v] != npos)
+				continue;
+			size_t best = v, best_w = 0;
+			for (size_t k = g.xadj[v]; k < g.xadj[v + 1]; k++)
+				if (match[g.adj[k]] == npos && g.adj[k] != v && g.ewgt[k] > best_w) {
+					best = g.adj[k];
+					best_w = g.ewgt[k];
+				}
+			match[v] = best;
+			match[best] = v;
+		}
+
+		cmap.assign(n, npos);
+		std::vector<size_t> first;
+		for (size_t v = 0; v < n; v++)
+			if (cmap[v] == npos) {
+				cmap[v] = cmap[match[v]] = first.size();
+				first.push_back(v);
+			}
+
+		Csr c;
+		size_t nc = first.size();
+		c.xadj.push_back(0);
+		c.vwgt.resize(nc);
+		std::vector<size_t> slot(nc, npos); // Position of each neighbor in c.adj
+		for (size_t cv = 0; cv < nc; cv++) {
+			size_t start = c.adj.size();
+			size_t members[2] = { first[cv], match[first[cv]] };
+			for (size_t i = 0; i < (members[0] == members[1] ? 1u : 2u); i++) {
+				size_t v = members[i];
+				c.vwgt[cv] += g.vwgt[v];
+				for (size_t k = g.xadj[v]; k < g.xadj[v + 1]; k++) {
+					size_t cu = cmap[g.adj[k]];
+					if (cu == cv)
+						continue;
+					if (slot[cu] == npos) {
+						slot[cu] = c.adj.size();
+						c.adj.push_back(cu);
+						c.ewgt.push_back(0);
+					}
+					c.ewgt[slot[cu]] += g.ewgt[k];
+				}
+			}
+			for (size_t k = start; k < c.adj.size(); k++)
+				slot[c.adj[k]] = npos;
+			c.xadj.push_back(c.adj.size());
+		}
+		return c;
+	}
+
+	// Tracks part weights and finds the best move of a vertex
+	struct Mover {
+		const Csr& g;
+		std::vector<size_t>& part;
+		std::vector<size_t> pw;  // Weight of each part
+		size_t maxw;             // Most weight a part may hold
+		std::vector<long> conn;  // Scratch: edge weight from a vertex to each part
+		std::vector<size_t> touched;
+
+		Mover(const Csr& g, std::vector<size_t>& part, size_t k, size_t maxw)
+				: g(g), part(part), pw(k), maxw(maxw), conn(k) {
+			for (size_t v = 0; v < g.size(); v++)
+				pw[part[v]] += g.vwgt[v];
+		}
+
+		// Best part to move v to, among those with room, and the reduction
+		// in cut; npos if v has no neighbor in such a part. With any_part,
+		// parts without neighbors are candidates too.
+		std::pair<long, size_t> best_move(size_t v, bool any_part = false) {
+			for (size_t k = g.xadj[v]; k < g.xadj[v + 1]; k++) {
+				size_t p = part[g.adj[k]];
+				if (!conn[p])
+					touched.push_back(p);
+				conn[p] += g.ewgt[k];
+			}
+			size_t from = part[v], to = npos;
+			long gain = 0;
+			for (size_t p = 0; p < pw.size(); p++) {
+				if (p == from || pw[p] + g.vwgt[v] > maxw || (!conn[p] && !any_part))
+					continue;
+				long gp = conn[p] - conn[from];
+				if (to == npos || gp > gain || (gp == gain && pw[p] < pw[to])) {
+					to = p;
+					gain = gp;
+				}
+			}
+			for (size_t p : touched)
+				conn[p] = 0;
+			touched.clear();
+			return { gain, to };
+		}
+
+		void move(size_t v, size_t to) {
+			pw[part[v]] -= g.vwgt[v];
+			pw[to] += g.vwgt[v];
+			part[v] = to;
+		}
+	};
+
+	// Move vertices out of overweight parts, preferring the moves that cut
+	// the fewest edges
+	inline void rebalance(Mover& m) {
+		for (size_t v = 0; v < m.g.size(); v++) {
+			if (m.pw[m.part[v]] <= m.maxw)
+				continue;
+			std::pair<long, size_t> mv = m.best_move(v, true);
+			if (mv.second != npos)
+				m.move(v, mv.second);
+		}
+	}
+
+	// Fiduccia-Mattheyses refinement generalized to k parts: repeatedly make
+	// the best move of any unmoved vertex, even if it increases the cut, and
+	// keep the prefix of moves that reduced the cut most
+	inline void refine(Mover& m, size_t passes = 4) {
+		const Csr& g = m.g;
+		size_t n = g.size();
+		size_t patience = std::max<size_t>(50, n / 100);
+		for (size_t pass = 0; pass < passes; pass++) {
+			std::priority_queue<std::tuple<long, size_t, size_t> > heap;
+			std::vector<bool> moved(n);
+			for (size_t v = 0; v < n; v++) {
+				std::pair<long, size_t> mv = m.best_move(v);
+				if (mv.second != npos)
+					heap.emplace(mv.first, v, mv.second);
+			}
+			std::vector<std::pair<size_t, size_t> > log; // Vertex and its old part
+			long total = 0, best = 0;
+			size_t best_len = 0, since_best = 0;
+			while (!heap.empty() && since_best < patience) {
+				long gain;
+				size_t v, to;
+				std::tie(gain, v, to) = heap.top();
+				heap.pop();
+				if (moved[v])
+					continue;
+				std::pair<long, size_t> mv = m.best_move(v);
+				if (mv.second == npos)
+					continue;
+				if (mv.first != gain || mv.second != to) {
+					heap.emplace(mv.first, v, mv.second);
+					continue;
+				}
+				log.push_back({ v, m.part[v] });
+				m.move(v, to);
+				moved[v] = true;
+				total += gain;
+				if (total > best) {
+					best = total;
+					best_len = log.size();
+					since_best = 0;
+				} else {
+					since_best++;
+				}
+				for (size_t k = g.xadj[v]; k < g.xadj[v + 1]; k++) {
+					size_t u = g.adj[k];
+					if (moved[u])
+						continue;
+					std::pair<long, size_t> mu = m.best_move(u);
+					if (mu.second != npos)
+						heap.emplace(mu.first, u, mu.second);
+				}
+			}
+			while (log.size() > best_len) {
+				m.move(log.back().first, log.back().second);
+				log.pop_back();
+			}
+			if (!best)
+				break;
+		}
+	}
+
+	// Grow each part in turn breadth-first from a random seed until it holds
+	// its share of the weight
+	inline std::vector<size_t> grow(const Csr& g, size_t k, std::mt19937& rng) {
+		size_t n = g.size(), total = 0;
+		for (size_t w : g.vwgt)
+			total += w;
+		std::vector<size_t> part(n, npos);
+		std::uniform_int_distribution<size_t> pick(0, n ? n - 1 : 0);
+		size_t left = n;
+		for (size_t p = 0; p + 1 < k && left; p++) {
+			size_t target = total * (p + 1) / k - total * p / k, weight = 0;
+			std::vector<size_t> queue;
+			for (size_t q = 0; weight < target && left; ) {
+				if (q == queue.size()) {
+					// Start again from a new seed when the region stops growing
+					size_t seed = pick(rng);
+					while (part[seed] != npos)
+						seed = (seed + 1) % n;
+					part[seed] = p;
+					weight += g.vwgt[seed];
+					left--;
+					queue.push_back(seed);
+				}
+				size_t v = queue[q++];
+				for (size_t e = g.xadj[v]; e < g.xadj[v + 1] && weight < target; e++) {
+					size_t u = g.adj[e];
+					if (part[u] == npos) {
+						part[u] = p;
+						weight += g.vwgt[u];
+						left--;
+						queue.push_back(u);
+					}
+				}
+			}
+		}
+		for (size_t& p : part)
+			if (p == npos)
+				p = k - 1;
+		return part;
+	}
+
+	// Most weight a part may hold: the allowed imbalance, relaxed on coarse
+	// graphs by the heaviest vertex so that some move is always possible
+	inline size_t max_weight(const Csr& g, size_t k, double imbalance) {
+		size_t total = 0, heaviest = 0;
+		for (size_t w : g.vwgt) {
+			total += w;
+			heaviest = std::max(heaviest, w);
+		}
+		size_t limit = (size_t) std::ceil(total * (1 + imbalance) / k);
+		return std::max(limit, (total + k - 1) / k + heaviest - 1);
+	}
+}
+
+/**
+ * @brief Split the vertices of an undirected graph into parts
+ *
+ * @param g The graph, with edge weights from weight()
+ * @param k Number of parts
+ * @param imbalance Most that any part may exceed the mean part size by, as
+ * a fraction of it
+ * @param seed Seed for the random choices
+ * @return std::map<int, size_t> Part of each vertex, from 0 to k - 1
+ *
+ * A multilevel partitioner in the manner of METIS. The graph is coarsened
+ * by repeatedly merging each vertex with the neighbor joined by the heaviest
+ * edge, the coarsest graph is split by growing parts breadth-first, and the
+ * split is projected back level by level, refined at each level by k-way
+ * Fiduccia-Mattheyses passes that reduce the total weight of cut edges.
+ * Loops are ignored.
+ */
+inline std::map<int, size_t> partition_multilevel(const Graph<int>& g, size_t k,
+		double imbalance = 0.03, unsigned seed = 1) {
+	using namespace partition_detail;
+	std::vector<int> names;
+	for (int v : g.vertex_view())
+		names.push_back(v);
+	auto index = [&](int v) { return std::lower_bound(names.begin(), names.end(), v) - names.begin(); };
+
+	std::vector<Csr> levels(1);
+	Csr& fine = levels[0];
+	fine.xadj.push_back(0);
+	for (auto it = g.vertex_view().begin(); it != g.vertex_view().end(); ++it) {
+		NeighborView<int> nv = it.neighbors();
+		for (auto q = nv.begin(); q != nv.end(); ++q)
+			if (*q != *it) {
+				fine.adj.push_back(index(*q));
+				fine.ewgt.push_back(q.weight());
+			}
+		fine.xadj.push_back(fine.adj.size());
+	}
+	fine.vwgt.assign(names.size(), 1);
+
+	std::mt19937 rng(seed);
+	std::vector<std::vector<size_t> > cmaps;
+	while (levels.back().size() > 20 * k) {
+		std::vector<size_t> cmap;
+		Csr c = coarsen(levels.back(), rng, cmap);
+		if (c.size() > levels.back().size() * 95 / 100)
+			break;
+		levels.push_back(std::move(c));
+		cmaps.push_back(std::move(cmap));
+	}
+
+	std::vector<size_t> part = grow(levels.back(), k, rng);
+	for (size_t l = levels.size(); l-- > 0; ) {
+		if (l + 1 < levels.size()) {
+			std::vector<size_t> finer(levels[l].size());
+			for (size_t v = 0; v < finer.size(); v++)
+				finer[v] = part[cmaps[l][v]];
+			part.swap(finer);
+		}
+		Mover m(levels[l], part, k, max_weight(levels[l], k, imbalance));
+		rebalance(m);
+		refine(m);
+	}
+
+	std::map<int, size_t> result;
+	for (size_t v = 0; v < names.size(); v++)
+		result.emplace_hint(result.end(), names[v], part[v]);
+	return result;
+}
+
+/**
+ * @brief Assigns vertices to parts as they arrive, in one pass
+ *
+ * Each vertex is placed when it arrives, with its neighbors, by a score
+ * favoring the parts that hold most of its already placed neighbors and
+ * penalizing full ones. Linear deterministic greedy (LDG) scales the
+ * neighbor count by the room left in the part; Fennel subtracts a cost that
+ * grows with the part's size.
+ */
+class StreamingPartitioner {
+public:
+	enum class Method { LDG, Fennel };
+	static constexpr size_t npos = (size_t) -1;
+
+	/**
+	 * @brief Create a partitioner with no vertices placed
+	 *
+	 * @param k Number of parts
+	 * @param vertices Expected number of vertices
+	 * @param edges Expected number of edges
+	 * @param method Scoring rule
+	 * @param imbalance Most that any part may exceed the mean part size by,
+	 * as a fraction of it
+	 */
+	StreamingPartitioner(size_t k, size_t vertices, size_t edges,
+			Method method = Method::Fennel, double imbalance = 0.1)
+		: sizes(k), count(k), method(method),
+		  capacity(std::max<double>(1, std::ceil(vertices * (1 + imbalance) / k))),
+		  alpha(vertices ? edges * std::sqrt((double) k) / std::pow((double) vertices, 1.5) : 0) { }
+
+	/**
+	 * @brief Place a vertex
+	 *
+	 * @param v The arriving vertex
+	 * @param neighbors Its neighbors; those not yet placed are ignored
+	 * @return size_t The part chosen for v, or its existing part if it has
+	 * already been placed
+	 */
+	template <typename Range>
+	size_t place(int v, const Range& neighbors);
+
+	/**
+	 * @brief Get the part of a vertex
+	 *
+	 * @param v The vertex of interest
+	 * @return size_t Its part, or npos if it has not been placed
+	 */
+	size_t part_of(int v) const {
+		auto it = assigned.find(v);
+		return it == assigned.end() ? npos : it->second;
+	}
+
+	const std::map<int, size_t>& parts() const { return assigned; }
+
+private:
+	std::map<int, size_t> assigned;
+	std::vector<size_t> sizes;
+	std::vector<size_t> count; // Scratch: placed neighbors in each part
+	Method method;
+	double capacity;
+	double alpha;              // Fennel's size penalty, with gamma = 1.5
+};
+
+template <typename Range>
+size_t StreamingPartitioner::place(int v, const Range& neighbors) {
+	size_t p = part_of(v);
+	if (p != npos)
+		return p;
+	std::fill(count.begin(), count.end(), 0);
+	for (int u : neighbors) {
+		size_t q = part_of(u);
+		if (q != npos)
+			count[q]++;
+	}
+	double best = 0;
+	for (size_t q = 0; q < sizes.size(); q++) {
+		if (sizes[q] >= capacity)
+			continue;
+		double score = method == Method::LDG
+			? count[q] * (1 - sizes[q] / capacity)
+			: count[q] - alpha * 1.5 * std::sqrt((double) sizes[q]);
+		if (p == npos || score > best || (score == best && sizes[q] < sizes[p])) {
+			p = q;
+			best = score;
+		}
+	}
+	if (p == npos) // Every part full; take the smallest
+		p = std::min_element(sizes.begin(), sizes.end()) - sizes.begin();
+	sizes[p]++;
+	assigned.emplace(v, p);
+	return p;
+}
+
+/**
+ * @brief Split an undirected graph by streaming its vertices in order
+ *
+ * @param g The graph
+ * @param k Number of parts
+ * @param method Scoring rule
+ * @return std::map<int, size_t> Part of each vertex, from 0 to k - 1
+ */
+inline std::map<int, size_t> partition_streaming(const Graph<int>& g, size_t k,
+		StreamingPartitioner::Method method = StreamingPartitioner::Method::Fennel) {
+	size_t edges = 0;
+	for (auto it = g.vertex_view().begin(); it != g.vertex_view().end(); ++it)
+		edges += it.neighbors().size();
+	StreamingPartitioner s(k, g.vertex_view().size(), edges / 2, method);
+	for (auto it = g.vertex_view().begin(); it != g.vertex_view().end(); ++it)
+		s.place(*it, it.neighbors());
+	return s.parts();
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Hardware performance counters for a measured region
+ *
+ * Wraps Linux perf_event_open to count cycles, instructions, last-level
+ * cache misses, branch misses and data TLB misses for the calling thread
+ * (and any threads it creates while counting). Counters the kernel or CPU
+ * does not support are skipped; if none can be opened, for example when
+ * perf_event_paranoid forbids it, available() returns false and all values
+ * read as zero. On other platforms no counters are ever available.
+ */
+class PerfCounters {
+public:
+	enum Event { CYCLES, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES, DTLB_MISSES,
+		NUM_EVENTS };
+
+	PerfCounters();
+	~PerfCounters();
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator= (const PerfCounters&) = delete;
+
+	/**
+	 * @brief Determine if any counter could be opened
+	 *
+	 * @return true At least one counter is being recorded
+	 * @return false No counters are available
+	 */
+	bool available() const;
+
+	/**
+	 * @brief Determine if a particular counter could be opened
+	 *
+	 * @param e The counter of interest
+	 * @return true Counter e is being recorded
+	 * @return false Counter e is not available
+	 */
+	bool has(Event e) const { return fd[e] >= 0; }
+
+	/**
+	 * @brief Reset and start all counters
+	 */
+	void start();
+
+	/**
+	 * @brief Stop all counters and read their values
+	 */
+	void stop();
+
+	/**
+	 * @brief Get the value of a counter from the last start/stop region
+	 *
+	 * @param e The counter of interest
+	 * @return uint64_t Count, scaled if the counter was multiplexed, or zero
+	 * if the counter is not available
+	 */
+	uint64_t value(Event e) const { return values[e]; }
+
+	/**
+	 * @brief Get a short display name for a counter
+	 *
+	 * @param e The counter of interest
+	 * @return const char* Name of the counter
+	 */
+	static const char* name(Event e);
+
+private:
+	int fd[NUM_EVENTS];
+	uint64_t values[NUM_EVENTS];
+};
+
+inline const char* PerfCounters::name(Event e) {
+	static const char* names[NUM_EVENTS] =
+		{ "cycles", "instructions", "llc-misses", "branch-misses", "dtlb-misses" };
+	return names[e];
+}
+
+inline bool PerfCounters::available() const {
+	for (int e = 0; e < NUM_EVENTS; e++)
+		if (fd[e] >= 0)
+			return true;
+	return false;
+}
+
+#ifdef __linux__
+
+inline PerfCounters::PerfCounters() {
+	static const uint32_t types[NUM_EVENTS] = {
+		PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+		PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE };
+	static const uint64_t configs[NUM_EVENTS] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+		PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) };
+
+	for (int e = 0; e < NUM_EVENTS; e++) {
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof attr);
+		attr.size = sizeof attr;
+		attr.type = types[e];
+		attr.config = configs[e];
+		attr.disabled = 1;
+		attr.inherit = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+			| PERF_FORMAT_TOTAL_TIME_RUNNING;
+		fd[e] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		values[e] = 0;
+	}
+}
+
+inline PerfCounters::~PerfCounters() {
+	for (int e = 0; e < NUM_EVENTS; e++)
+		if (fd[e] >= 0)
+			close(fd[e]);
+}
+
+inline void PerfCounters::start() {
+	for (int e = 0; e < NUM_EVENTS; e++) {
+		if (fd[e] >= 0) {
+			ioctl(fd[e], PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd[e], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+inline void PerfCounters::stop() {
+	for (int e = 0; e < NUM_EVENTS; e++)
+		if (fd[e] >= 0)
+			ioctl(fd[e], PERF_EVENT_IOC_DISABLE, 0);
+
+	// Values are { count, time enabled, time running }; scale up when the
+	// kernel had to multiplex more counters than the PMU has
+	for (int e = 0; e < NUM_EVENTS; e++) {
+		uint64_t buf[3] = { 0, 0, 0 };
+		values[e] = 0;
+		if (fd[e] >= 0 && read(fd[e], buf, sizeof buf) == sizeof buf && buf[2])
+			values[e] = buf[2] < buf[1]
+				? (uint64_t) ((double) buf[0] * buf[1] / buf[2]) : buf[0];
+	}
+}
+
+#else
+
+inline PerfCounters::PerfCounters() {
+	for (int e = 0; e < NUM_EVENTS; e++) {
+		fd[e] = -1;
+		values[e] = 0;
+	}
+}
+
+inline PerfCounters::~PerfCounters() { }
+inline void PerfCounters::start() { }
+inline void PerfCounters::stop() { }
+
+#endif
@@ -0,0 +1,528 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A unit of work run by a Scheduler
+ *
+ * Tasks delete themselves after running.
+ */
+class Task {
+public:
+	virtual ~Task() = default;
+	virtual void run() = 0;
+};
+
+/**
+ * @brief Lock-free work-stealing deque of tasks
+ *
+ * The Chase-Lev deque as given for weak memory models by Lê et al. (PPoPP
+ * 2013). Only the owning thread may push() and pop(), working at the bottom;
+ * any thread may steal() from the top. The array grows as needed; retired
+ * arrays are kept until the deque is destroyed, since a thief may still be
+ * reading from one.
+ */
+class WorkDeque {
+public:
+	WorkDeque() : array(new Array(64)) { retired.emplace_back(array.load()); }
+	WorkDeque(const WorkDeque&) = delete;
+	WorkDeque& operator= (const WorkDeque&) = delete;
+
+	/**
+	 * @brief Add a task at the bottom (owner only)
+	 *
+	 * @param t The task
+	 */
+	void push(Task* t);
+
+	/**
+	 * @brief Remove the most recently pushed task (owner only)
+	 *
+	 * @return Task* The task, or nullptr if the deque is empty
+	 */
+	Task* pop();
+
+	/**
+	 * @brief Remove the oldest task (any thread)
+	 *
+	 * @return Task* The task, or nullptr if the deque is empty or another
+	 * thread won the race for it
+	 */
+	Task* steal();
+
+	/**
+	 * @brief Determine if the deque looks empty (any thread)
+	 *
+	 * @return true No task was queued when checked
+	 * @return false Some task may be waiting to be stolen
+	 */
+	bool empty() const
+		{ return top.load(std::memory_order_relaxed) >= bottom.load(std::memory_order_relaxed); }
+
+private:
+	struct Array {
+		size_t cap;
+		std::unique_ptr<std::atomic<Task*>[]> buf;
+		explicit Array(size_t cap) : cap(cap), buf(new std::atomic<Task*>[cap]) { }
+		Task* get(int64_t i) const
+			{ return buf[i & (cap - 1)].load(std::memory_order_relaxed); }
+		void put(int64_t i, Task* t)
+			{ buf[i & (cap - 1)].store(t, std::memory_order_relaxed); }
+	};
+
+	std::atomic<int64_t> top{0};
+	std::atomic<int64_t> bottom{0};
+	std::atomic<Array*> array;
+	std::vector<std::unique_ptr<Array> > retired; // Owns every array
+};
+
+inline void WorkDeque::push(Task* t) {
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t tp = top.load(std::memory_order_acquire);
+	Array* a = array.load(std::memory_order_relaxed);
+	if (b - tp > (int64_t) a->cap - 1) {
+		Array* bigger = new Array(a->cap * 2);
+		for (int64_t i = tp; i < b; i++)
+			bigger->put(i, a->get(i));
+		retired.emplace_back(bigger);
+		array.store(bigger, std::memory_order_release);
+		a = bigger;
+	}
+	a->put(b, t);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+inline Task* WorkDeque::pop() {
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	Array* a = array.load(std::memory_order_relaxed);
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+	Task* x = nullptr;
+	if (t <= b) {
+		x = a->get(b);
+		if (t == b) {
+			// Last task; race any thieves for it
+			if (!top.compare_exchange_strong(t, t + 1,
+					std::memory_order_seq_cst, std::memory_order_relaxed))
+				x = nullptr;
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+	} else {
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return x;
+}
+
+inline Task* WorkDeque::steal() {
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+	if (t >= b)
+		return nullptr;
+	Task* x = array.load(std::memory_order_acquire)->get(t);
+	if (!top.compare_exchange_strong(t, t + 1,
+			std::memory_order_seq_cst, std::memory_order_relaxed))
+		return nullptr;
+	return x;
+}
+
+/**
+ * @brief Pool of worker threads that balance load by work stealing
+ *
+ * Each worker owns a WorkDeque. Tasks spawned by a worker go on its own
+ * deque, where it runs them newest first; idle workers steal the oldest
+ * tasks of others, which for divide-and-conquer loops are the largest. Tasks
+ * spawned from outside the pool go on a shared queue. Threads waiting for
+ * tasks (see TaskGroup) run other tasks while they wait, so tasks may spawn
+ * and wait for tasks of their own. Idle workers sleep until a task is
+ * submitted, and a pool being destroyed runs every queued task before its
+ * workers stop.
+ *
+ * All parallel routines should use the shared instance() rather than create
+ * threads of their own. Long-running work that nobody waits on at once, such
+ * as a search started in the background, goes to background() instead, so
+ * that a thread waiting in instance() never picks it up and stalls.
+ */
+class Scheduler {
+public:
+	/**
+	 * @brief Start a pool
+	 *
+	 * @param threads Number of worker threads; zero means one per hardware
+	 * thread
+	 */
+	explicit Scheduler(size_t threads = 0);
+	~Scheduler();
+	Scheduler(const Scheduler&) = delete;
+	Scheduler& operator= (const Scheduler&) = delete;
+
+	/**
+	 * @brief Get the process-wide pool
+	 *
+	 * @return Scheduler& Pool with one worker per hardware thread
+	 */
+	static Scheduler& instance() { static Scheduler s; return s; }
+
+	/**
+	 * @brief Get the process-wide pool for long-running background tasks
+	 *
+	 * @return Scheduler& Pool with one worker per hardware thread, started
+	 * on first use
+	 */
+	static Scheduler& background() { static Scheduler s; return s; }
+
+	/**
+	 * @brief Get number of worker threads
+	 *
+	 * @return size_t Number of workers
+	 */
+	size_t concurrency() const { return workers.size(); }
+
+	/**
+	 * @brief Queue a task to be run
+	 *
+	 * @param t The task, which the scheduler runs once and then deletes
+	 */
+	void submit(Task* t);
+
+	/**
+	 * @brief Run one queued task on the calling thread, if there is one
+	 *
+	 * @return true A task was run
+	 * @return false No task was available
+	 */
+	bool run_one();
+
+	/**
+	 * @brief Determine if the calling thread is one of the pool's workers
+	 *
+	 * @return true The caller is a worker, so blocking it holds up the pool
+	 * @return false The caller is some other thread
+	 */
+	bool is_worker() { return current_scheduler() == this; }
+
+private:
+	struct Worker {
+		WorkDeque deque;
+		std::thread thread;
+	};
+
+	std::vector<std::unique_ptr<Worker> > workers;
+	std::mutex mutex;               // Guards injected
+	std::deque<Task*> injected;     // Tasks from outside the pool
+	std::condition_variable wake;
+	std::atomic<size_t> sleeping{0};
+	std::atomic<bool> stopping{false};
+
+	Task* find_task(Worker* self);
+	bool queued();
+	void work(Worker* self);
+
+	// Worker the calling thread belongs to, if any
+	Worker*& current() {
+		thread_local Worker* w = nullptr;
+		return w;
+	}
+	Scheduler*& current_scheduler() {
+		thread_local Scheduler* s = nullptr;
+		return s;
+	}
+};
+
+inline Scheduler::Scheduler(size_t threads) {
+	if (!threads)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	for (size_t i = 0; i < threads; i++)
+		workers.emplace_back(new Worker);
+	for (auto& w : workers)
+		w->thread = std::thread(&Scheduler::work, this, w.get());
+}
+
+inline Scheduler::~Scheduler() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	// Workers stop only once they find no task to run, so nothing queued
+	// before this is lost
+	for (auto& w : workers)
+		w->thread.join();
+	for (Task* t : injected)
+		delete t;
+}
+
+inline void Scheduler::submit(Task* t) {
+	Worker* self = current_scheduler() == this ? current() : nullptr;
+	if (self) {
+		self->deque.push(t);
+	} else {
+		std::lock_guard<std::mutex> lock(mutex);
+		injected.push_back(t);
+	}
+	// Pairs with the fence in work(): either a sleeper sees the task, or
+	// this sees the sleeper and wakes it once it is waiting
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (sleeping.load(std::memory_order_relaxed)) {
+		std::lock_guard<std::mutex> lock(mutex);
+		wake.notify_one();
+	}
+}
+
+inline Task* Scheduler::find_task(Worker* self) {
+	if (self)
+		if (Task* t = self->deque.pop())
+			return t;
+
+	// Steal, starting from a random victim to spread contention
+	thread_local std::minstd_rand rng(std::hash<std::thread::id>()(
+		std::this_thread::get_id()));
+	size_t n = workers.size();
+	size_t first = rng() % n;
+	for (size_t i = 0; i < n; i++) {
+		Worker* victim = workers[(first + i) % n].get();
+		if (victim != self)
+			if (Task* t = victim->deque.steal())
+				return t;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (injected.empty())
+		return nullptr;
+	Task* t = injected.front();
+	injected.pop_front();
+	return t;
+}
+
+inline bool Scheduler::run_one() {
+	Worker* self = current_scheduler() == this ? current() : nullptr;
+	Task* t = find_task(self);
+	if (!t)
+		return false;
+	t->run();
+	delete t;
+	return true;
+}
+
+inline bool Scheduler::queued() {
+	if (!injected.empty())
+		return true;
+	for (auto& w : workers)
+		if (!w->deque.empty())
+			return true;
+	return false;
+}
+
+inline void Scheduler::work(Worker* self) {
+	current() = self;
+	current_scheduler() = this;
+	size_t idle = 0;
+	for (;;) {
+		if (run_one()) {
+			idle = 0;
+		} else if (stopping.load(std::memory_order_acquire)) {
+			break;
+		} else if (++idle < 64) {
+			std::this_thread::yield();
+		} else {
+			std::unique_lock<std::mutex> lock(mutex);
+			sleeping.fetch_add(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (!stopping && !queued())
+				wake.wait(lock);
+			sleeping.fetch_sub(1, std::memory_order_relaxed);
+			idle = 0;
+		}
+	}
+}
+
+/**
+ * @brief A set of tasks that can be waited for together
+ *
+ * The thread that waits runs queued tasks (from this group or any other)
+ * until every task in the group has finished, so waiting inside a task does
+ * not tie up a worker. If a task throws, the first exception is rethrown by
+ * wait().
+ */
+class TaskGroup {
+public:
+	explicit TaskGroup(Scheduler& s = Scheduler::instance()) : s(s) { }
+	~TaskGroup() {
+		// Tasks refer to the group, so they must finish before it goes away
+		while (pending.load(std::memory_order_acquire))
+			if (!s.run_one())
+				std::this_thread::yield();
+	}
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator= (const TaskGroup&) = delete;
+
+	/**
+	 * @brief Start a task in the group
+	 *
+	 * @tparam F Callable with no parameters
+	 * @param f The work to be done
+	 */
+	template <typename F>
+	void spawn(F f);
+
+	/**
+	 * @brief Wait for all tasks in the group
+	 */
+	void wait();
+
+	/**
+	 * @brief Get the scheduler that runs the group's tasks
+	 *
+	 * @return Scheduler& The scheduler
+	 */
+	Scheduler& scheduler() const { return s; }
+
+private:
+	template <typename F>
+	class FnTask : public Task {
+	public:
+		FnTask(TaskGroup& g, F f) : g(g), f(std::move(f)) { }
+		void run() override {
+			try {
+				f();
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(g.error_mutex);
+				if (!g.error)
+					g.error = std::current_exception();
+			}
+			g.pending.fetch_sub(1, std::memory_order_acq_rel);
+		}
+	private:
+		TaskGroup& g;
+		F f;
+	};
+
+	Scheduler& s;
+	std::atomic<size_t> pending{0};
+	std::mutex error_mutex;
+	std::exception_ptr error;
+};
+
+template <typename F>
+void TaskGroup::spawn(F f) {
+	pending.fetch_add(1, std::memory_order_relaxed);
+	s.submit(new FnTask<F>(*this, std::move(f)));
+}
+
+inline void TaskGroup::wait() {
+	while (pending.load(std::memory_order_acquire))
+		if (!s.run_one())
+			std::this_thread::yield();
+	if (error) {
+		std::exception_ptr e = error;
+		error = nullptr;
+		std::rethrow_exception(e);
+	}
+}
+
+namespace scheduler_detail {
+	template <typename F>
+	void for_range(TaskGroup& tg, size_t begin, size_t end, size_t grain, F& f) {
+		// Hand the upper halves to thieves, keep the lowest piece
+		while (end - begin > grain) {
+			size_t mid = begin + (end - begin) / 2;
+			tg.spawn([&tg, mid, end, grain, &f] { for_range(tg, mid, end, grain, f); });
+			end = mid;
+		}
+		f(begin, end);
+	}
+
+	template <typename P, typename F>
+	void for_weighted(TaskGroup& tg, size_t begin, size_t end, P& prefix,
+		size_t grain, F& f)
+	{
+		while (end - begin > 1 && prefix(end) - prefix(begin) > grain) {
+			// Split where half the weight of the range lies on either side
+			size_t half = prefix(begin) + (prefix(end) - prefix(begin)) / 2;
+			size_t lo = begin + 1, hi = end - 1;
+			while (lo < hi) {
+				size_t m = lo + (hi - lo) / 2;
+				if (prefix(m) < half)
+					lo = m + 1;
+				else
+					hi = m;
+			}
+			size_t mid = lo;
+			tg.spawn([&tg, mid, end, &prefix, grain, &f]
+				{ for_weighted(tg, mid, end, prefix, grain, f); });
+			end = mid;
+		}
+		f(begin, end);
+	}
+}
+
+/**
+ * @brief Run a loop in parallel over a range of indices
+ *
+ * @tparam F Callable as f(size_t lo, size_t hi), processing indices lo
+ * through hi - 1
+ * @param begin First index
+ * @param end One past the last index
+ * @param f The loop body, called on disjoint subranges covering the range
+ * @param grain Largest subrange given to one call of f; zero picks a size
+ * that gives each worker several subranges
+ * @param s Scheduler to run on
+ *
+ * Returns when every index has been processed.
+ */
+template <typename F>
+void parallel_for(size_t begin, size_t end, F f, size_t grain = 0,
+	Scheduler& s = Scheduler::instance()) {
+	if (begin >= end)
+		return;
+	if (!grain)
+		grain = std::max<size_t>(1, (end - begin) / (8 * s.concurrency()));
+	TaskGroup tg(s);
+	scheduler_detail::for_range(tg, begin, end, grain, f);
+	tg.wait();
+}
+
+/**
+ * @brief Run a loop in parallel, splitting by weight rather than by count
+ *
+ * @tparam P Callable as prefix(size_t i), returning the total weight of
+ * indices before i; must be nondecreasing
+ * @tparam F Callable as f(size_t lo, size_t hi)
+ * @param begin First index
+ * @param end One past the last index
+ * @param prefix Cumulative weight, such as CSR offsets for degree weighting
+ * @param f The loop body, called on disjoint subranges covering the range
+ * @param grain Largest weight given to one call of f, unless a single index
+ * weighs more; zero picks a weight that gives each worker several subranges
+ * @param s Scheduler to run on
+ *
+ * For loops over vertices whose cost depends on degree, subranges with a few
+ * high-degree vertices are made as costly as those with many low-degree
+ * ones, so skewed graphs do not leave one task with most of the work.
+ */
+template <typename P, typename F>
+void parallel_for_weighted(size_t begin, size_t end, P prefix, F f,
+	size_t grain = 0, Scheduler& s = Scheduler::instance()) {
+	if (begin >= end)
+		return;
+	if (!grain)
+		grain = std::max<size_t>(1,
+			(prefix(end) - prefix(begin)) / (8 * s.concurrency()));
+	TaskGroup tg(s);
+	scheduler_detail::for_weighted(tg, begin, end, prefix, grain, f);
+	tg.wait();
+}
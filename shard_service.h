@@ -0,0 +1,853 @@
+#pragma once
+
+#include "graph.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * @brief Serving a graph split by vertex across processes
+ *
+ * Each shard process owns the vertices that hash to it, with their outward
+ * edges, and answers batched neighbors, is_edge and weight queries over a
+ * Unix domain socket. A ShardClient splits each batch of queries by owner,
+ * sends one request to every shard involved before reading any reply, and
+ * puts the answers back in the order asked. For Euler paths each shard
+ * sends its edges once, as trails, for the client to join. LocalShards
+ * starts the shard processes on the local machine, so the whole arrangement
+ * can be run and checked on one host.
+ *
+ * Messages are a 4-byte length followed by a request kind and LEB128
+ * varints, with vertices zigzag-encoded; both ends must share byte order,
+ * which holds for sockets on one host.
+ */
+namespace shard {
+	enum Op : uint8_t { Neighbors, IsEdge, Weight, Stats, Trails };
+
+	// Largest message either side sends or accepts, so that a corrupt
+	// length cannot make the reader allocate gigabytes
+	constexpr uint32_t MAX_MESSAGE = 1u << 28;
+
+	/**
+	 * @brief Get the shard owning a vertex
+	 *
+	 * @param v The vertex of interest
+	 * @param shards Number of shards
+	 * @return size_t Index of the owning shard
+	 */
+	inline size_t owner(int v, size_t shards) { return graph_detail::mix((uint64_t) v) % shards; }
+
+	/**
+	 * @brief Get the shard owning a vertex under a chosen placement
+	 *
+	 * @param v The vertex of interest
+	 * @param shards Number of shards
+	 * @param placement Shard of each placed vertex, such as from a
+	 * partitioner; vertices not listed are placed by hash
+	 * @return size_t Index of the owning shard
+	 */
+	inline size_t owner(int v, size_t shards, const std::map<int, size_t>& placement) {
+		auto it = placement.find(v);
+		return it != placement.end() ? it->second % shards : owner(v, shards);
+	}
+
+	// Message encoding and socket I/O
+	struct Writer {
+		std::vector<uint8_t> buf;
+		void varint(uint64_t x) {
+			while (x >= 0x80) {
+				buf.push_back((uint8_t) (x | 0x80));
+				x >>= 7;
+			}
+			buf.push_back((uint8_t) x);
+		}
+		void vertex(int v) { varint(((uint64_t) (int64_t) v << 1) ^ (uint64_t) ((int64_t) v >> 63)); }
+		void delta(int v, int64_t& prev) {
+			int64_t d = (int64_t) v - prev;
+			varint(((uint64_t) d << 1) ^ (uint64_t) (d >> 63));
+			prev = v;
+		}
+	};
+
+	struct Reader {
+		const uint8_t* p;
+		const uint8_t* end;
+		uint64_t varint() {
+			uint64_t x = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				if (p == end)
+					throw std::runtime_error("shard: truncated message");
+				uint8_t c = *p++;
+				x |= (uint64_t) (c & 0x7f) << shift;
+				if (!(c & 0x80))
+					break;
+			}
+			return x;
+		}
+		int vertex() { uint64_t z = varint(); return (int) ((int64_t) (z >> 1) ^ -(int64_t) (z & 1)); }
+		int delta(int64_t& prev) {
+			uint64_t z = varint();
+			prev += (int64_t) (z >> 1) ^ -(int64_t) (z & 1);
+			return (int) prev;
+		}
+	};
+
+	inline void fail(const char* what) { throw std::system_error(errno, std::generic_category(), what); }
+
+	inline void send_all(int fd, const void* data, size_t n) {
+		const char* p = (const char*) data;
+		while (n) {
+			ssize_t k = ::send(fd, p, n, MSG_NOSIGNAL);
+			if (k < 0 && errno == EINTR)
+				continue;
+			if (k <= 0)
+				fail("shard: send");
+			p += k;
+			n -= k;
+		}
+	}
+
+	// Returns false at end of stream before any byte is read
+	inline bool recv_all(int fd, void* data, size_t n) {
+		char* p = (char*) data;
+		size_t got = 0;
+		while (got < n) {
+			ssize_t k = ::recv(fd, p + got, n - got, 0);
+			if (k < 0 && errno == EINTR)
+				continue;
+			if (k < 0)
+				fail("shard: recv");
+			if (k == 0) {
+				if (!got)
+					return false;
+				throw std::runtime_error("shard: connection closed mid-message");
+			}
+			got += k;
+		}
+		return true;
+	}
+
+	inline void send_message(int fd, const std::vector<uint8_t>& m) {
+		if (m.size() > MAX_MESSAGE)
+			throw std::length_error("shard: message too large");
+		uint32_t n = (uint32_t) m.size();
+		send_all(fd, &n, sizeof n);
+		send_all(fd, m.data(), m.size());
+	}
+
+	inline bool recv_message(int fd, std::vector<uint8_t>& m) {
+		uint32_t n;
+		if (!recv_all(fd, &n, sizeof n))
+			return false;
+		if (n > MAX_MESSAGE)
+			throw std::runtime_error("shard: message too large");
+		m.resize(n);
+		if (n && !recv_all(fd, m.data(), n))
+			throw std::runtime_error("shard: connection closed mid-message");
+		return true;
+	}
+
+	// Close every descriptor a forked shard inherited but does not need,
+	// such as other shards' sockets or the parent's perf counters
+	inline void close_inherited(int keep) {
+#ifdef SYS_close_range
+		if ((keep <= 3 || ::syscall(SYS_close_range, 3u, (unsigned) keep - 1, 0u) == 0)
+				&& ::syscall(SYS_close_range, (unsigned) keep + 1, ~0u, 0u) == 0)
+			return;
+#endif
+		long max = ::sysconf(_SC_OPEN_MAX);
+		for (int fd = 3; fd < (max > 0 && max < 65536 ? max : 65536); fd++)
+			if (fd != keep)
+				::close(fd);
+	}
+
+	inline sockaddr_un address(const std::string& path) {
+		sockaddr_un a;
+		std::memset(&a, 0, sizeof a);
+		a.sun_family = AF_UNIX;
+		if (path.size() >= sizeof a.sun_path)
+			throw std::invalid_argument("shard: socket path too long");
+		std::memcpy(a.sun_path, path.c_str(), path.size());
+		return a;
+	}
+
+	/**
+	 * @brief Split a shard's edges into the fewest trails
+	 *
+	 * @param g The shard's vertices and their outward edges, each edge of
+	 * the undirected graph being stored at both ends
+	 * @return std::vector<std::vector<int> > The vertices along each trail
+	 *
+	 * The shard of the smaller end of an edge owns it. Each vertex of odd
+	 * degree in the owned edges is joined to one extra vertex, and an Euler
+	 * circuit of each piece of the result is cut at the extra vertex. That
+	 * leaves one trail per pair of odd vertices, ending at them, and a
+	 * closed trail for each piece with no odd vertex.
+	 */
+	inline std::vector<std::vector<int> > local_trails(const DiGraph<int>& g) {
+		std::vector<int> names;
+		std::map<int, size_t> index;
+		auto id = [&](int v) {
+			auto r = index.emplace(v, names.size());
+			if (r.second)
+				names.push_back(v);
+			return r.first->second;
+		};
+		std::vector<std::pair<size_t, size_t> > edges;
+		for (auto it = g.vertex_view().begin(); it != g.vertex_view().end(); ++it) {
+			NeighborView<int> nv = it.neighbors();
+			for (auto q = nv.begin(); q != nv.end(); ++q)
+				if (*it <= *q)
+					edges.push_back({ id(*it), id(*q) });
+		}
+
+		size_t n = names.size(), extra = n;
+		std::vector<size_t> xadj(n + 2);
+		for (const auto& e : edges) {
+			xadj[e.first]++;
+			xadj[e.second]++;
+		}
+		for (size_t v = 0; v < n; v++)
+			if (xadj[v] % 2) {
+				edges.push_back({ extra, v });
+				xadj[extra]++;
+				xadj[v]++;
+			}
+		// Counts to offsets, then fill each vertex's edge numbers
+		size_t total = 0;
+		for (size_t& x : xadj) {
+			size_t c = x;
+			x = total;
+			total += c;
+		}
+		std::vector<size_t> adj(total), cursor(xadj.begin(), xadj.end() - 1);
+		for (size_t k = 0; k < edges.size(); k++) {
+			adj[cursor[edges[k].first]++] = k;
+			if (edges[k].second != edges[k].first)
+				adj[cursor[edges[k].second]++] = k;
+		}
+		cursor.assign(xadj.begin(), xadj.end() - 1);
+
+		std::vector<std::vector<int> > trails;
+		std::vector<bool> used(edges.size());
+		std::vector<size_t> stack, circuit;
+		for (size_t s = n + 1; s-- > 0; ) {
+			// The extra vertex first, so that open trails absorb what they can
+			size_t start = s == n ? extra : s;
+			stack.assign(1, start);
+			circuit.clear();
+			while (!stack.empty()) {
+				size_t v = stack.back();
+				while (cursor[v] < xadj[v + 1] && used[adj[cursor[v]]])
+					cursor[v]++;
+				if (cursor[v] == xadj[v + 1]) {
+					circuit.push_back(v);
+					stack.pop_back();
+				} else {
+					const auto& e = edges[adj[cursor[v]]];
+					used[adj[cursor[v]]] = true;
+					stack.push_back(e.first == v ? e.second : e.first);
+				}
+			}
+			if (circuit.size() < 2)
+				continue;
+			if (start != extra) {
+				trails.emplace_back();
+				for (size_t v : circuit)
+					trails.back().push_back(names[v]);
+				continue;
+			}
+			for (size_t v : circuit) {
+				if (v == extra) {
+					if (!trails.empty() && trails.back().empty())
+						continue;
+					trails.emplace_back();
+				} else {
+					trails.back().push_back(names[v]);
+				}
+			}
+			if (trails.back().empty())
+				trails.pop_back();
+		}
+		return trails;
+	}
+
+	/**
+	 * @brief Answer one request about a shard
+	 *
+	 * @param g The shard's vertices and their outward edges
+	 * @param owned Number of vertices of g that the shard owns; the rest
+	 * are only the far ends of its edges
+	 * @param request The request
+	 * @return std::vector<uint8_t> The reply
+	 */
+	inline std::vector<uint8_t> answer(const DiGraph<int>& g, size_t owned,
+		const std::vector<uint8_t>& request) {
+		Reader in{ request.data(), request.data() + request.size() };
+		Writer out;
+		if (in.p == in.end)
+			throw std::runtime_error("shard: empty request");
+		uint8_t op = *in.p++;
+		if (op > Trails)
+			throw std::runtime_error("shard: unknown request");
+		if (op == Stats) {
+			// Vertices, vertices with edges, edges, odd-degree vertices, and
+			// the smallest vertex with an edge, if any
+			size_t with_edges = 0, edges = 0, odd = 0;
+			bool found = false;
+			int first = 0;
+			for (auto it = g.vertex_view().begin(); it != g.vertex_view().end(); ++it) {
+				size_t d = it.neighbors().size();
+				edges += d;
+				odd += d % 2;
+				if (d) {
+					with_edges++;
+					if (!found)
+						first = *it;
+					found = true;
+				}
+			}
+			out.varint(owned);
+			out.varint(with_edges);
+			out.varint(edges);
+			out.varint(odd);
+			out.varint(found);
+			out.vertex(first);
+			return out.buf;
+		}
+		if (op == Trails) {
+			std::vector<std::vector<int> > trails = local_trails(g);
+			out.varint(trails.size());
+			int64_t prev = 0;
+			for (const std::vector<int>& t : trails) {
+				out.varint(t.size());
+				for (int v : t)
+					out.delta(v, prev);
+			}
+			return out.buf;
+		}
+		// Each vertex takes at least a byte, so a count the rest of the
+		// request cannot hold is refused before anything is allocated
+		size_t n = in.varint();
+		size_t per_item = op == Neighbors ? 1 : 2;
+		if (n > (size_t) (in.end - in.p) / per_item)
+			throw std::runtime_error("shard: truncated request");
+		if (op == IsEdge || op == Weight) {
+			// Answered together, sorted by source
+			std::vector<std::pair<int, int> > probes(n);
+			for (auto& p : probes) {
+				p.first = in.vertex();
+				p.second = in.vertex();
+			}
+			if (op == IsEdge)
+				for (bool b : g.is_edge(probes))
+					out.varint(b);
+			else
+				for (size_t w : g.weight(probes))
+					out.varint(w);
+			return out.buf;
+		}
+		for (size_t i = 0; i < n; i++) {
+			NeighborView<int> nv = g.neighbor_view(in.vertex());
+			out.varint(nv.size());
+			for (auto it = nv.begin(); it != nv.end(); ++it) {
+				out.vertex(*it);
+				out.varint(it.weight());
+			}
+		}
+		return out.buf;
+	}
+
+	/**
+	 * @brief Serve queries about a shard until the process is stopped
+	 *
+	 * @param listen_fd A listening Unix domain socket
+	 * @param g The shard's vertices and their outward edges
+	 * @param owned Number of vertices of g that the shard owns
+	 *
+	 * Serves one client at a time, each until it disconnects.
+	 */
+	inline void serve(int listen_fd, const DiGraph<int>& g, size_t owned) {
+		std::vector<uint8_t> request;
+		for (;;) {
+			int fd = ::accept(listen_fd, nullptr, nullptr);
+			if (fd < 0) {
+				if (errno == EINTR)
+					continue;
+				fail("shard: accept");
+			}
+			try {
+				while (recv_message(fd, request))
+					send_message(fd, answer(g, owned, request));
+			} catch (const std::exception&) {
+				// Drop the client; the next one starts afresh
+			}
+			::close(fd);
+		}
+	}
+}
+
+/**
+ * @brief Shard processes running on the local machine
+ *
+ * Splits a graph by vertex owner, and forks one process per shard, each
+ * listening on its own socket in the given directory. Destroying the object
+ * stops the processes and removes the sockets.
+ */
+class LocalShards {
+public:
+	/**
+	 * @brief Start the shard processes
+	 *
+	 * @param g The graph to serve
+	 * @param shards Number of shard processes
+	 * @param dir Directory for the sockets
+	 * @param placement Shard of each vertex, such as from a partitioner;
+	 * vertices not listed are placed by hash
+	 * @throw std::system_error A socket or process could not be created
+	 */
+	LocalShards(const DiGraph<int>& g, size_t shards, const std::string& dir = "/tmp",
+		const std::map<int, size_t>& placement = std::map<int, size_t>());
+	~LocalShards();
+	LocalShards(const LocalShards&) = delete;
+	LocalShards& operator= (const LocalShards&) = delete;
+
+	const std::vector<std::string>& paths() const { return paths_; }
+
+private:
+	std::vector<std::string> paths_;
+	std::vector<pid_t> pids;
+
+	void stop();
+};
+
+/**
+ * @brief Queries a graph served by shard processes
+ *
+ * Connects to every shard, in order of shard index. Queries are answered as
+ * by a DiGraph holding the whole graph.
+ */
+class ShardClient {
+public:
+	/**
+	 * @brief Connect to the shards
+	 *
+	 * @param paths Socket of each shard, in order of shard index
+	 * @param placement The placement the shards were started with
+	 * @throw std::system_error A shard could not be reached
+	 */
+	explicit ShardClient(const std::vector<std::string>& paths,
+		const std::map<int, size_t>& placement = std::map<int, size_t>());
+	~ShardClient() { for (int fd : fds) ::close(fd); }
+	ShardClient(const ShardClient&) = delete;
+	ShardClient& operator= (const ShardClient&) = delete;
+
+	size_t shard_count() const { return fds.size(); }
+
+	/**
+	 * @brief Find the neighbors of many vertices
+	 *
+	 * @param vs The vertices of interest
+	 * @return std::vector<std::vector<int> > Outward neighbors of each vertex,
+	 * in ascending order; empty for a vertex that does not exist
+	 */
+	std::vector<std::vector<int> > neighbors(const std::vector<int>& vs);
+
+	/**
+	 * @brief Determine if many edges exist
+	 *
+	 * @param es Pairs of vertices at which each edge begins and ends
+	 * @return std::vector<bool> Whether each edge exists
+	 */
+	std::vector<bool> is_edge(const std::vector<std::pair<int, int> >& es);
+
+	/**
+	 * @brief Get the weights of many edges
+	 *
+	 * @param es Pairs of vertices at which each edge begins and ends
+	 * @return std::vector<size_t> Weight of each edge, or zero if it does not
+	 * exist
+	 */
+	std::vector<size_t> weight(const std::vector<std::pair<int, int> >& es);
+
+	/**
+	 * @brief Find shortest path lengths by breadth-first search
+	 *
+	 * @param source The vertex to search from
+	 * @return std::map<int, size_t> Number of edges to each vertex reached
+	 *
+	 * Expands a whole level at a time, with one batched neighbors request to
+	 * each shard per level.
+	 */
+	std::map<int, size_t> bfs(int source);
+
+	/**
+	 * @brief Count vertices of odd degree
+	 *
+	 * @return size_t Number of vertices with an odd number of outward edges
+	 */
+	size_t odd_vertices();
+
+	/**
+	 * @brief Determine if an undirected graph has an Euler path or circuit
+	 *
+	 * @return true All edges lie in one connected piece with at most two
+	 * vertices of odd degree
+	 * @return false Otherwise, or if the graph has no edges
+	 *
+	 * The graph must be undirected, each edge being stored in both
+	 * directions as Graph does.
+	 */
+	bool has_euler_path();
+
+	/**
+	 * @brief Collect each shard's edges as trails
+	 *
+	 * @return std::vector<std::vector<int> > The trails of every shard, as
+	 * from shard::local_trails(); together they hold each undirected edge
+	 * once
+	 */
+	std::vector<std::vector<int> > trails();
+
+	/**
+	 * @brief Find an Euler path or circuit of an undirected graph
+	 *
+	 * @return std::vector<int> The vertices along the path, or an empty
+	 * vector if the graph has no Euler path
+	 *
+	 * Each shard sends its edges once, as trails, and the trails are joined
+	 * here by Hierholzer's algorithm, which follows the current trail for as
+	 * long as it can. Starts at the smallest vertex of odd degree, if any,
+	 * else at the smallest vertex with an edge.
+	 */
+	std::vector<int> find_path();
+
+private:
+	std::vector<int> fds;
+	std::map<int, size_t> placement;
+
+	struct Summary {
+		size_t vertices, with_edges, edges, odd;
+		bool found;
+		int first;
+	};
+	Summary stats();
+
+	// Send each shard its part of a batch, then read every reply
+	template <typename Key, typename Owner, typename Encode, typename Decode>
+	void scatter(shard::Op op, const std::vector<Key>& keys, Owner owner_key,
+		Encode encode, Decode decode);
+};
+
+inline LocalShards::LocalShards(const DiGraph<int>& g, size_t shards, const std::string& dir,
+		const std::map<int, size_t>& placement) {
+	// update_edge also adds each edge's far end, owned or not, so count
+	// the owned vertices separately
+	std::vector<DiGraph<int> > parts(shards);
+	std::vector<size_t> owned(shards);
+	for (auto it = g.vertex_view().begin(); it != g.vertex_view().end(); ++it) {
+		size_t i = shard::owner(*it, shards, placement);
+		DiGraph<int>& part = parts[i];
+		owned[i]++;
+		part.add_vertex(*it);
+		NeighborView<int> nv = it.neighbors();
+		for (auto q = nv.begin(); q != nv.end(); ++q)
+			part.update_edge(*it, *q, q.weight());
+	}
+
+	try {
+		for (size_t i = 0; i < shards; i++) {
+			std::string path = dir + "/euler-shard-" + std::to_string(::getpid()) + "-"
+				+ std::to_string(i) + ".sock";
+			sockaddr_un a = shard::address(path);
+			int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (fd < 0)
+				shard::fail("shard: socket");
+			::unlink(path.c_str());
+			if (::bind(fd, (sockaddr*) &a, sizeof a) < 0 || ::listen(fd, 16) < 0) {
+				::close(fd);
+				shard::fail("shard: bind");
+			}
+			paths_.push_back(path);
+			pid_t pid = ::fork();
+			if (pid < 0) {
+				::close(fd);
+				shard::fail("shard: fork");
+			}
+			if (pid == 0) {
+				// Only this thread survives the fork, so the shard serves
+				// on it alone and keeps no other descriptor
+				try {
+					shard::close_inherited(fd);
+					shard::serve(fd, parts[i], owned[i]);
+				} catch (...) {
+				}
+				::_exit(1);
+			}
+			pids.push_back(pid);
+			::close(fd);
+		}
+	} catch (...) {
+		stop();
+		throw;
+	}
+}
+
+inline LocalShards::~LocalShards() { stop(); }
+
+inline void LocalShards::stop() {
+	for (pid_t pid : pids)
+		::kill(pid, SIGTERM);
+	for (pid_t pid : pids)
+		::waitpid(pid, nullptr, 0);
+	for (const std::string& path : paths_)
+		::unlink(path.c_str());
+}
+
+inline ShardClient::ShardClient(const std::vector<std::string>& paths,
+		const std::map<int, size_t>& placement) : placement(placement) {
+	for (const std::string& path : paths) {
+		sockaddr_un a = shard::address(path);
+		int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+			shard::fail("shard: socket");
+		if (::connect(fd, (sockaddr*) &a, sizeof a) < 0) {
+			int err = errno;
+			::close(fd);
+			for (int f : fds)
+				::close(f);
+			errno = err;
+			shard::fail("shard: connect");
+		}
+		fds.push_back(fd);
+	}
+}
+
+template <typename Key, typename Owner, typename Encode, typename Decode>
+void ShardClient::scatter(shard::Op op, const std::vector<Key>& keys, Owner owner_key,
+		Encode encode, Decode decode) {
+	size_t n = fds.size();
+	std::vector<std::vector<size_t> > which(n); // Positions in keys, by shard
+	for (size_t k = 0; k < keys.size(); k++)
+		which[shard::owner(owner_key(keys[k]), n, placement)].push_back(k);
+	for (size_t s = 0; s < n; s++) {
+		if (which[s].empty())
+			continue;
+		shard::Writer out;
+		out.buf.push_back(op);
+		out.varint(which[s].size());
+		for (size_t k : which[s])
+			encode(out, keys[k]);
+		shard::send_message(fds[s], out.buf);
+	}
+	std::vector<uint8_t> reply;
+	for (size_t s = 0; s < n; s++) {
+		if (which[s].empty())
+			continue;
+		if (!shard::recv_message(fds[s], reply))
+			throw std::runtime_error("shard: connection closed");
+		shard::Reader in{ reply.data(), reply.data() + reply.size() };
+		for (size_t k : which[s])
+			decode(in, k);
+	}
+}
+
+inline std::vector<std::vector<int> > ShardClient::neighbors(const std::vector<int>& vs) {
+	std::vector<std::vector<int> > result(vs.size());
+	scatter(shard::Neighbors, vs, [](int v) { return v; },
+		[](shard::Writer& out, int v) { out.vertex(v); },
+		[&](shard::Reader& in, size_t k) {
+			size_t d = in.varint();
+			result[k].resize(d);
+			for (size_t i = 0; i < d; i++) {
+				result[k][i] = in.vertex();
+				in.varint(); // Weight
+			}
+		});
+	return result;
+}
+
+inline std::vector<bool> ShardClient::is_edge(const std::vector<std::pair<int, int> >& es) {
+	std::vector<bool> result(es.size());
+	scatter(shard::IsEdge, es, [](const std::pair<int, int>& e) { return e.first; },
+		[](shard::Writer& out, const std::pair<int, int>& e)
+			{ out.vertex(e.first); out.vertex(e.second); },
+		[&](shard::Reader& in, size_t k) { result[k] = in.varint(); });
+	return result;
+}
+
+inline std::vector<size_t> ShardClient::weight(const std::vector<std::pair<int, int> >& es) {
+	std::vector<size_t> result(es.size());
+	scatter(shard::Weight, es, [](const std::pair<int, int>& e) { return e.first; },
+		[](shard::Writer& out, const std::pair<int, int>& e)
+			{ out.vertex(e.first); out.vertex(e.second); },
+		[&](shard::Reader& in, size_t k) { result[k] = in.varint(); });
+	return result;
+}
+
+inline std::map<int, size_t> ShardClient::bfs(int source) {
+	std::map<int, size_t> dist;
+	std::vector<int> frontier(1, source), next;
+	dist[source] = 0;
+	for (size_t level = 1; !frontier.empty(); level++) {
+		next.clear();
+		for (const std::vector<int>& nv : neighbors(frontier))
+			for (int u : nv)
+				if (dist.emplace(u, level).second)
+					next.push_back(u);
+		frontier.swap(next);
+	}
+	return dist;
+}
+
+inline ShardClient::Summary ShardClient::stats() {
+	Summary total{ 0, 0, 0, 0, false, 0 };
+	std::vector<uint8_t> request(1, shard::Stats), reply;
+	for (int fd : fds)
+		shard::send_message(fd, request);
+	for (int fd : fds) {
+		if (!shard::recv_message(fd, reply))
+			throw std::runtime_error("shard: connection closed");
+		shard::Reader in{ reply.data(), reply.data() + reply.size() };
+		total.vertices += in.varint();
+		total.with_edges += in.varint();
+		total.edges += in.varint();
+		total.odd += in.varint();
+		bool found = in.varint();
+		int first = in.vertex();
+		if (found && (!total.found || first < total.first))
+			total.first = first;
+		total.found = total.found || found;
+	}
+	return total;
+}
+
+inline size_t ShardClient::odd_vertices() { return stats().odd; }
+
+inline bool ShardClient::has_euler_path() {
+	Summary s = stats();
+	if (!s.found || (s.odd && s.odd != 2))
+		return false;
+	// Every vertex with an edge must be reachable from one of them
+	return bfs(s.first).size() == s.with_edges;
+}
+
+inline std::vector<std::vector<int> > ShardClient::trails() {
+	std::vector<std::vector<int> > all;
+	std::vector<uint8_t> request(1, shard::Trails), reply;
+	for (int fd : fds)
+		shard::send_message(fd, request);
+	for (int fd : fds) {
+		if (!shard::recv_message(fd, reply))
+			throw std::runtime_error("shard: connection closed");
+		shard::Reader in{ reply.data(), reply.data() + reply.size() };
+		int64_t prev = 0;
+		for (size_t t = in.varint(); t > 0; t--) {
+			all.emplace_back(in.varint());
+			for (int& v : all.back())
+				v = in.delta(prev);
+		}
+	}
+	return all;
+}
+
+inline std::vector<int> ShardClient::find_path() {
+	std::vector<std::vector<int> > ts = trails();
+
+	// Every place each vertex appears in a trail, sorted by vertex, and the
+	// first edge number of each trail, edge i of a trail joining positions
+	// i and i + 1
+	struct Place {
+		int v;
+		size_t t;
+		size_t pos;
+		bool operator< (const Place& o) const { return v < o.v; }
+	};
+	std::vector<Place> places;
+	std::vector<size_t> base(ts.size() + 1);
+	std::map<int, size_t> ends; // Trail ends at each vertex; odd means odd degree
+	for (size_t t = 0; t < ts.size(); t++) {
+		base[t + 1] = base[t] + ts[t].size() - 1;
+		for (size_t pos = 0; pos < ts[t].size(); pos++)
+			places.push_back({ ts[t][pos], t, pos });
+		if (ts[t].front() != ts[t].back()) {
+			ends[ts[t].front()]++;
+			ends[ts[t].back()]++;
+		}
+	}
+	std::vector<int> path;
+	if (places.empty())
+		return path;
+	std::stable_sort(places.begin(), places.end());
+
+	size_t count_odd = 0;
+	int start = places.front().v;
+	for (const auto& p : ends)
+		if (p.second % 2 && !count_odd++)
+			start = p.first;
+	if (count_odd && count_odd != 2)
+		return path;
+
+	const size_t none = (size_t) -1;
+	struct Step {
+		int v;
+		size_t t;    // Trail arrived along, or none
+		size_t pos;  // Position in that trail
+	};
+	std::vector<bool> used(base.back());
+	std::vector<size_t> cursor(places.size()); // For the first place of each vertex
+	for (size_t i = 0; i < places.size(); i++)
+		cursor[i] = i;
+	std::vector<Step> stack(1, { start, none, 0 });
+	auto first_place = [&](int v) {
+		return std::lower_bound(places.begin(), places.end(), Place{ v, 0, 0 }) - places.begin();
+	};
+	// Take an unused edge of trail t at position pos, if any
+	auto take = [&](size_t t, size_t pos) {
+		if (pos + 1 < ts[t].size() && !used[base[t] + pos]) {
+			used[base[t] + pos] = true;
+			stack.push_back({ ts[t][pos + 1], t, pos + 1 });
+			return true;
+		}
+		if (pos > 0 && !used[base[t] + pos - 1]) {
+			used[base[t] + pos - 1] = true;
+			stack.push_back({ ts[t][pos - 1], t, pos - 1 });
+			return true;
+		}
+		return false;
+	};
+	while (!stack.empty()) {
+		Step s = stack.back();
+		if (s.t != none && take(s.t, s.pos))
+			continue;
+		size_t lo = first_place(s.v);
+		size_t& c = cursor[lo];
+		while (c < places.size() && places[c].v == s.v && !take(places[c].t, places[c].pos))
+			c++;
+		if (c == places.size() || places[c].v != s.v) {
+			path.push_back(s.v);
+			stack.pop_back();
+		}
+	}
+
+	// Fewer steps than edges means the edges are not connected
+	if (path.size() != base.back() + 1)
+		path.clear();
+	std::reverse(path.begin(), path.end());
+	return path;
+}
@@ -0,0 +1,323 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Sorted map from neighbor to edge weight with inline small storage
+ *
+ * @tparam T Data type of vertices, which must be default constructible
+ * @tparam N Number of neighbors stored inline
+ *
+ * Neighbors and weights are kept in two parallel arrays sorted by neighbor.
+ * Up to N of them live inside the object itself, so the neighbors of a
+ * low-degree vertex are scanned from one or two cache lines with no pointer
+ * chasing; beyond N they move to heap arrays that grow geometrically. Past
+ * TREE neighbors, where shifting the arrays on every insertion or erasure
+ * would make building a hub quadratic, they move to a std::map instead.
+ * Each move back (to the arrays, or inline) waits until the count has
+ * halved, so a degree that hovers around a threshold does not allocate and
+ * free on every change.
+ *
+ * Provides the parts of the std::map interface that DiGraph uses. Iterators
+ * yield proxies with first (the neighbor) and second (the weight) members,
+ * and are invalidated by any insertion or erasure.
+ */
+template <typename T, size_t N = 8>
+class SmallAdjacency {
+	using Tree = std::map<T, size_t>;
+public:
+	static constexpr size_t TREE = 64 > 2 * N ? 64 : 2 * N;
+
+	/**
+	 * @brief A neighbor and the weight of the edge to it
+	 */
+	struct reference {
+		const T& first;
+		const size_t& second;
+		const reference* operator-> () const { return this; }
+	};
+
+	class const_iterator {
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = typename SmallAdjacency::reference;
+		using difference_type = std::ptrdiff_t;
+		using pointer = typename SmallAdjacency::reference;
+		using reference = typename SmallAdjacency::reference;
+
+		const_iterator() = default;
+		const_iterator(const SmallAdjacency* a, size_t i) : a(a), i(i) { }
+		const_iterator(const SmallAdjacency* a, typename Tree::const_iterator t)
+			: a(a), t(t) { }
+		reference operator* () const {
+			if (a->tree)
+				return { t->first, t->second };
+			return { a->keys()[i], a->weights()[i] };
+		}
+		reference operator-> () const { return **this; }
+		const_iterator& operator++ () { a->tree ? (void) ++t : (void) ++i; return *this; }
+		const_iterator operator++ (int) { const_iterator old = *this; ++*this; return old; }
+		const_iterator& operator-- () { a->tree ? (void) --t : (void) --i; return *this; }
+		const_iterator operator-- (int) { const_iterator old = *this; --*this; return old; }
+		bool operator== (const const_iterator& o) const { return i == o.i && t == o.t; }
+		bool operator!= (const const_iterator& o) const { return !(*this == o); }
+	private:
+		friend class SmallAdjacency;
+		const SmallAdjacency* a = nullptr;
+		size_t i = 0;                      // Position while in arrays
+		typename Tree::const_iterator t{}; // Position once spilled
+	};
+
+	SmallAdjacency() { }
+	SmallAdjacency(const SmallAdjacency& o) { *this = o; }
+	SmallAdjacency(SmallAdjacency&& o) noexcept { *this = std::move(o); }
+	SmallAdjacency& operator= (const SmallAdjacency& o);
+	SmallAdjacency& operator= (SmallAdjacency&& o) noexcept;
+
+	const_iterator begin() const
+		{ return tree ? const_iterator(this, tree->cbegin()) : const_iterator(this, 0); }
+	const_iterator end() const
+		{ return tree ? const_iterator(this, tree->cend()) : const_iterator(this, n); }
+	size_t size() const { return n; }
+	bool empty() const { return !n; }
+
+	/**
+	 * @brief Find a neighbor
+	 *
+	 * @param v The neighbor of interest
+	 * @return const_iterator Position of v, or end() if v is not a neighbor
+	 */
+	const_iterator find(const T& v) const {
+		if (tree)
+			return { this, tree->find(v) };
+		size_t i = position(v);
+		return { this, i < n && !(v < keys()[i]) ? i : n };
+	}
+
+	/**
+	 * @brief Find the first neighbor not less than a vertex
+	 *
+	 * @param v The vertex of interest
+	 * @param from Position to search from, which must not be past the answer
+	 * @return const_iterator Position of the first neighbor not less than v
+	 *
+	 * In arrays, searches ahead of from by doubling steps and then by
+	 * bisection, so a sweep through ascending vertices costs little more
+	 * than a merge. Once spilled, searches the whole map.
+	 */
+	const_iterator lower_bound(const T& v, const_iterator from) const;
+	const_iterator lower_bound(const T& v) const { return lower_bound(v, begin()); }
+
+	/**
+	 * @brief Get weight of the edge to a neighbor
+	 *
+	 * @param v The neighbor of interest
+	 * @return size_t Weight of the edge
+	 * @throw std::out_of_range v is not a neighbor
+	 */
+	size_t at(const T& v) const {
+		const_iterator it = find(v);
+		if (it == end())
+			throw std::out_of_range("SmallAdjacency::at");
+		return it->second;
+	}
+
+	/**
+	 * @brief Get weight of the edge to a neighbor for updating
+	 *
+	 * @param v The neighbor of interest, added with weight zero if absent
+	 * @return size_t& Weight of the edge
+	 */
+	size_t& operator[] (const T& v) { return *try_emplace(v, 0).first; }
+
+	/**
+	 * @brief Add a neighbor if it is absent
+	 *
+	 * @param v The neighbor of interest
+	 * @param w Weight of the edge to v, if it is added
+	 * @return std::pair<size_t*, bool> Weight of the edge to v, and whether v
+	 * was added
+	 */
+	std::pair<size_t*, bool> try_emplace(const T& v, size_t w);
+
+	/**
+	 * @brief Remove a neighbor
+	 *
+	 * @param v The neighbor to be removed
+	 * @return size_t 1 if v was a neighbor, else 0
+	 */
+	size_t erase(const T& v);
+
+	/**
+	 * @brief Remove all neighbors
+	 */
+	void clear() { n = 0; release(); }
+
+private:
+	T inline_keys[N];
+	size_t inline_weights[N];
+	std::unique_ptr<T[]> heap_keys;        // Used when n > N
+	std::unique_ptr<size_t[]> heap_weights;
+	std::unique_ptr<Tree> tree;            // Used instead when n > TREE
+	size_t cap = N;
+	size_t n = 0;
+
+	T* keys() { return heap_keys ? heap_keys.get() : inline_keys; }
+	const T* keys() const { return heap_keys ? heap_keys.get() : inline_keys; }
+	size_t* weights() { return heap_keys ? heap_weights.get() : inline_weights; }
+	const size_t* weights() const
+		{ return heap_keys ? heap_weights.get() : inline_weights; }
+	size_t position(const T& v) const
+		{ return std::lower_bound(keys(), keys() + n, v) - keys(); }
+	void resize(size_t new_cap);
+	void release() { heap_keys.reset(); heap_weights.reset(); tree.reset(); cap = N; }
+};
+
+template <typename T, size_t N>
+SmallAdjacency<T, N>& SmallAdjacency<T, N>::operator= (const SmallAdjacency& o) {
+	if (this == &o)
+		return *this;
+	release();
+	if (o.tree) {
+		tree.reset(new Tree(*o.tree));
+	} else {
+		if (o.n > N) {
+			heap_keys.reset(new T[o.n]);
+			heap_weights.reset(new size_t[o.n]);
+			cap = o.n;
+		}
+		std::copy(o.keys(), o.keys() + o.n, keys());
+		std::copy(o.weights(), o.weights() + o.n, weights());
+	}
+	n = o.n;
+	return *this;
+}
+
+template <typename T, size_t N>
+SmallAdjacency<T, N>& SmallAdjacency<T, N>::operator= (SmallAdjacency&& o) noexcept {
+	if (this == &o)
+		return *this;
+	release();
+	if (o.tree || o.heap_keys) {
+		tree = std::move(o.tree);
+		heap_keys = std::move(o.heap_keys);
+		heap_weights = std::move(o.heap_weights);
+		cap = o.cap;
+	} else {
+		std::move(o.inline_keys, o.inline_keys + o.n, inline_keys);
+		std::copy(o.inline_weights, o.inline_weights + o.n, inline_weights);
+	}
+	n = o.n;
+	o.n = 0;
+	o.release();
+	return *this;
+}
+
+template <typename T, size_t N>
+void SmallAdjacency<T, N>::resize(size_t new_cap) {
+	// Move between inline and heap arrays, or reallocate the heap arrays
+	if (new_cap <= N) {
+		if (heap_keys) {
+			std::move(heap_keys.get(), heap_keys.get() + n, inline_keys);
+			std::copy(heap_weights.get(), heap_weights.get() + n, inline_weights);
+			heap_keys.reset();
+			heap_weights.reset();
+		}
+		cap = N;
+		return;
+	}
+	std::unique_ptr<T[]> nk(new T[new_cap]);
+	std::unique_ptr<size_t[]> nw(new size_t[new_cap]);
+	std::move(keys(), keys() + n, nk.get());
+	std::copy(weights(), weights() + n, nw.get());
+	heap_keys = std::move(nk);
+	heap_weights = std::move(nw);
+	cap = new_cap;
+}
+
+template <typename T, size_t N>
+typename SmallAdjacency<T, N>::const_iterator
+SmallAdjacency<T, N>::lower_bound(const T& v, const_iterator from) const {
+	if (tree)
+		return { this, tree->lower_bound(v) };
+	const T* k = keys();
+	size_t lo = from.i, step = 1;
+	while (lo + step < n && k[lo + step] < v) {
+		lo += step;
+		step *= 2;
+	}
+	return { this, (size_t) (std::lower_bound(k + lo, k + std::min(lo + step, n), v) - k) };
+}
+
+template <typename T, size_t N>
+std::pair<size_t*, bool> SmallAdjacency<T, N>::try_emplace(const T& v, size_t w) {
+	if (!tree) {
+		size_t i = position(v);
+		if (i < n && !(v < keys()[i]))
+			return { weights() + i, false };
+		if (n < TREE) {
+			if (n == cap)
+				resize(std::min(cap * 2, TREE));
+			T* k = keys();
+			size_t* ws = weights();
+			std::move_backward(k + i, k + n, k + n + 1);
+			std::copy_backward(ws + i, ws + n, ws + n + 1);
+			k[i] = v;
+			ws[i] = w;
+			n++;
+			return { ws + i, true };
+		}
+		// Too many to keep shifting; spill to the map
+		std::unique_ptr<Tree> t(new Tree);
+		for (size_t j = 0; j < n; j++)
+			t->emplace_hint(t->end(), std::move(keys()[j]), weights()[j]);
+		heap_keys.reset();
+		heap_weights.reset();
+		cap = N;
+		tree = std::move(t);
+	}
+	// Hinting at the end makes ascending insertion constant time
+	auto r = tree->empty() || tree->rbegin()->first < v
+		? std::make_pair(tree->emplace_hint(tree->end(), v, w), true)
+		: tree->try_emplace(v, w);
+	n += r.second;
+	return { &r.first->second, r.second };
+}
+
+template <typename T, size_t N>
+size_t SmallAdjacency<T, N>::erase(const T& v) {
+	if (tree) {
+		if (!tree->erase(v))
+			return 0;
+		n--;
+		if (n <= TREE / 2) {
+			// Small again; move back to arrays and free the map
+			std::unique_ptr<Tree> t = std::move(tree);
+			size_t m = n;
+			n = 0;
+			resize(m);
+			for (auto& p : *t) {
+				keys()[n] = p.first;
+				weights()[n++] = p.second;
+			}
+		}
+		return 1;
+	}
+	size_t i = position(v);
+	if (i == n || v < keys()[i])
+		return 0;
+	T* k = keys();
+	size_t* w = weights();
+	std::move(k + i + 1, k + n, k + i);
+	std::copy(w + i + 1, w + n, w + i);
+	n--;
+	if (heap_keys && n <= N / 2)
+		resize(N); // Small again; move back inline and free the heap arrays
+	return 1;
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief An undirected, unweighted graph of at most N vertices
+ *
+ * @tparam N Capacity; vertices are the integers 0 through N - 1
+ *
+ * Adjacency is kept inline as one bitset per vertex, so the graph never
+ * allocates, can be copied with a memcpy, and can be built and queried in
+ * constant expressions. Queries follow Graph<T>; weight() is 1 for every
+ * edge. Vertices outside 0 through N - 1 are ignored by updates and do not
+ * exist for queries.
+ */
+template <size_t N>
+class SmallGraph {
+public:
+	static constexpr size_t WORDS = (N + 63) / 64;
+
+	/**
+	 * @brief A range over the neighbors of one vertex, in ascending order
+	 */
+	class NeighborRange {
+	public:
+		class iterator {
+		public:
+			constexpr iterator(const std::array<uint64_t, WORDS>& bits, size_t w,
+				uint64_t word) : bits(&bits), w(w), word(word) { skip(); }
+			constexpr int operator* () const
+				{ return (int) (w * 64 + __builtin_ctzll(word)); }
+			constexpr iterator& operator++ () { word &= word - 1; skip(); return *this; }
+			constexpr bool operator!= (const iterator& o) const
+				{ return w != o.w || word != o.word; }
+		private:
+			const std::array<uint64_t, WORDS>* bits;
+			size_t w;
+			uint64_t word;
+
+			// Move to the next word with a bit set, or to the end
+			constexpr void skip() {
+				while (!word && w < WORDS)
+					if (++w < WORDS)
+						word = (*bits)[w];
+			}
+		};
+
+		constexpr explicit NeighborRange(const std::array<uint64_t, WORDS>& bits)
+			: bits(bits) { }
+		constexpr iterator begin() const { return iterator(bits, 0, bits[0]); }
+		constexpr iterator end() const { return iterator(bits, WORDS, 0); }
+	private:
+		const std::array<uint64_t, WORDS>& bits;
+	};
+
+	constexpr SmallGraph() : adj(), present() { }
+
+	/**
+	 * @brief Add an edge to the graph
+	 *
+	 * @param v1 One end of the edge
+	 * @param v2 Other end of the edge
+	 *
+	 * Either vertex that does not already exist is created.
+	 */
+	constexpr void add_edge(int v1, int v2) {
+		if (!in_range(v1) || !in_range(v2))
+			return;
+		set(adj[v1], v2);
+		set(adj[v2], v1);
+		add_vertex(v1);
+		add_vertex(v2);
+	}
+
+	/**
+	 * @brief Adds a vertex to the graph
+	 *
+	 * @param v Vertex to be added
+	 */
+	constexpr void add_vertex(int v) { if (in_range(v)) set(present, v); }
+
+	/**
+	 * @brief Get degree of vertex
+	 *
+	 * @param v The vertex of interest
+	 * @return size_t Number of edges attached to v; a loop counts once
+	 */
+	constexpr size_t degree(int v) const {
+		size_t d = 0;
+		if (is_vertex(v))
+			for (uint64_t word : adj[v])
+				d += __builtin_popcountll(word);
+		return d;
+	}
+
+	/**
+	 * @brief Determine if edge exists between two vertices
+	 *
+	 * @param v1 One end of the edge
+	 * @param v2 Other end of the edge
+	 * @return true An edge exists between v1 and v2
+	 * @return false No edge exists between v1 and v2
+	 */
+	constexpr bool is_edge(int v1, int v2) const
+		{ return in_range(v1) && in_range(v2) && test(adj[v1], v2); }
+
+	/**
+	 * @brief Determine if a vertex exists
+	 *
+	 * @param v The vertex of interest
+	 * @return true Vertex v exists in the graph
+	 * @return false Vertex v does not exist in the graph
+	 */
+	constexpr bool is_vertex(int v) const { return in_range(v) && test(present, v); }
+
+	/**
+	 * @brief Get the neighbors of a vertex
+	 *
+	 * @param v The vertex of interest, which must be in range
+	 * @return NeighborRange Vertices connected to v by a single edge
+	 */
+	constexpr NeighborRange neighbors(int v) const { return NeighborRange(adj[v]); }
+
+	/**
+	 * @brief Get the vertices of the graph
+	 *
+	 * @return NeighborRange All vertices, in ascending order
+	 */
+	constexpr NeighborRange vertices() const { return NeighborRange(present); }
+
+	/**
+	 * @brief Remove a vertex from the graph
+	 *
+	 * @param v The vertex to be removed, along with its edges
+	 */
+	constexpr void remove(int v) {
+		if (!is_vertex(v))
+			return;
+		for (size_t u = 0; u < N; u++)
+			clear(adj[u], v);
+		adj[v] = std::array<uint64_t, WORDS>();
+		clear(present, v);
+	}
+
+	/**
+	 * @brief Remove an edge from the graph
+	 *
+	 * @param v1 One end of the edge
+	 * @param v2 Other end of the edge
+	 */
+	constexpr void remove_edge(int v1, int v2) {
+		if (!in_range(v1) || !in_range(v2))
+			return;
+		clear(adj[v1], v2);
+		clear(adj[v2], v1);
+	}
+
+	/**
+	 * @brief Get weight of an edge
+	 *
+	 * @param v1 One end of the edge
+	 * @param v2 Other end of the edge
+	 * @return size_t 1 if the edge exists, else 0
+	 */
+	constexpr size_t weight(int v1, int v2) const { return is_edge(v1, v2); }
+
+private:
+	std::array<std::array<uint64_t, WORDS>, N> adj;
+	std::array<uint64_t, WORDS> present;
+
+	static constexpr bool in_range(int v) { return v >= 0 && (size_t) v < N; }
+	static constexpr void set(std::array<uint64_t, WORDS>& b, int v)
+		{ b[v / 64] |= uint64_t(1) << (v % 64); }
+	static constexpr void clear(std::array<uint64_t, WORDS>& b, int v)
+		{ b[v / 64] &= ~(uint64_t(1) << (v % 64)); }
+	static constexpr bool test(const std::array<uint64_t, WORDS>& b, int v)
+		{ return b[v / 64] >> (v % 64) & 1; }
+};
+
+/**
+ * @brief A path of at most Cap vertices, stored inline
+ */
+template <size_t Cap>
+struct FixedPath {
+	std::array<int, Cap> v{};
+	size_t size = 0;
+
+	constexpr void push_back(int x) { v[size++] = x; }
+	constexpr const int* begin() const { return v.data(); }
+	constexpr const int* end() const { return v.data() + size; }
+	constexpr bool empty() const { return !size; }
+};
+
+/**
+ * @brief Find an Euler path or circuit in a small graph
+ *
+ * @tparam N Capacity of the graph
+ * @param g The graph of interest
+ * @return FixedPath<N * (N + 1) / 2 + 1> The vertices along the path, or an
+ * empty path if the graph has no Euler path
+ *
+ * Follows the same rules as find_path(), so gives the same path for graphs
+ * without vertex 0 (find_path() does not allow a vertex 0). Performs no heap
+ * allocation and may be evaluated at compile time.
+ */
+template <size_t N>
+constexpr FixedPath<N * (N + 1) / 2 + 1> find_path(SmallGraph<N> g) {
+	FixedPath<N * (N + 1) / 2 + 1> p;
+
+	int count_odd = 0;
+	int first_odd = -1;
+	for (int v : g.vertices()) {
+		if (g.degree(v) % 2) {
+			count_odd++;
+			if (first_odd < 0)
+				first_odd = v;
+		}
+	}
+	if (count_odd && count_odd != 2)
+		return p;
+
+	int start = first_odd;
+	if (start < 0)
+		for (int v : g.vertices())
+			if (start < 0)
+				start = v;
+	if (start < 0)
+		return p;
+
+	// Smallest neighbor other than the start, else the start
+	p.push_back(start);
+	for (int cur = start; g.degree(cur); ) {
+		int next = -1;
+		for (int v : g.neighbors(cur))
+			if (next < 0 && v != start)
+				next = v;
+		if (next < 0)
+			next = start;
+		g.remove_edge(cur, next);
+		p.push_back(next);
+		cur = next;
+	}
+	return p;
+}
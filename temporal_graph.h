@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief An undirected multigraph whose edges exist over time intervals
+ *
+ * @tparam T Data type of vertices
+ *
+ * Each edge exists over a half-open interval [begin, end) of time. The same
+ * pair of vertices may be joined by any number of edges with different
+ * intervals. Each vertex keeps its edges sorted by begin time, along with
+ * the latest end among each edge and those before it, so the edges of a
+ * vertex that overlap a time window are found by binary search, and a
+ * Window answers queries over one window without copying any edges.
+ */
+template <typename T>
+class TemporalGraph {
+public:
+	using Time = int64_t;
+	static constexpr size_t npos = (size_t) -1;
+
+	class Window;
+
+	/**
+	 * @brief Add an edge to the graph
+	 *
+	 * @param v1 One end of the edge
+	 * @param v2 Other end of the edge
+	 * @param begin First time at which the edge exists
+	 * @param end Time at which the edge stops existing
+	 * @throw std::invalid_argument end is not after begin
+	 *
+	 * Either vertex that does not already exist is created. A loop (v1 equal
+	 * to v2) is stored once.
+	 */
+	void add_edge(const T& v1, const T& v2, Time begin, Time end);
+
+	/**
+	 * @brief Adds a vertex to the graph
+	 *
+	 * @param v Vertex to be added
+	 */
+	void add_vertex(const T& v) { vertex(v); }
+
+	/**
+	 * @brief Determine if a vertex exists
+	 *
+	 * @param v The vertex of interest
+	 * @return true Vertex v exists in the graph
+	 * @return false Vertex v does not exist in the graph
+	 */
+	bool is_vertex(const T& v) const { return index.find(v) != index.end(); }
+
+	size_t vertex_count() const { return names.size(); }
+	size_t edge_count() const { return edges; }
+
+	/**
+	 * @brief Get a view of the edges that exist during a window of time
+	 *
+	 * @param t0 Start of the window
+	 * @param t1 End of the window, which is not part of it
+	 * @return Window The view, valid until the graph is next changed
+	 */
+	Window window(Time t0, Time t1) const { return Window(*this, t0, t1); }
+
+private:
+	struct Edge {
+		size_t to;  // Index of the other end
+		Time begin;
+		Time end;
+		size_t id;  // Shared by both halves of the edge
+		Time reach; // Latest end of this and all earlier edges in the list
+	};
+
+	std::map<T, size_t> index;           // Vertex to its index
+	std::vector<T> names;                // Index to vertex
+	std::vector<std::vector<Edge> > adj; // Sorted by begin
+	size_t edges = 0;
+
+	size_t vertex(const T& v);
+	void insert(size_t i, const Edge& e);
+	std::pair<size_t, size_t> candidates(size_t i, Time t0, Time t1) const;
+};
+
+/**
+ * @brief The edges of a temporal graph that exist during [t0, t1)
+ *
+ * An edge is in the window if its interval overlaps the window. All vertices
+ * of the graph are vertices of the window, some possibly with no edges.
+ */
+template <typename T>
+class TemporalGraph<T>::Window {
+public:
+	Window(const TemporalGraph& g, Time t0, Time t1) : g(&g), t0(t0), t1(t1) { }
+
+	/**
+	 * @brief Get degree of vertex within the window
+	 *
+	 * @param v The vertex of interest
+	 * @return size_t Number of edges attached to v; a loop counts once
+	 */
+	size_t degree(const T& v) const;
+
+	/**
+	 * @brief Find all neighbors of a given vertex within the window
+	 *
+	 * @param v The vertex of interest
+	 * @return std::list<T> The other end of each edge attached to v, ordered
+	 * by the begin time of the edge, so a neighbor joined by several edges
+	 * appears several times. If vertex v does not exist, returns an empty
+	 * list.
+	 */
+	std::list<T> neighbors(const T& v) const;
+
+	/**
+	 * @brief Determine if an edge exists between two vertices in the window
+	 *
+	 * @param v1 One end of the edge
+	 * @param v2 Other end of the edge
+	 * @return true Some edge between v1 and v2 overlaps the window
+	 * @return false No edge between v1 and v2 overlaps the window
+	 */
+	bool is_edge(const T& v1, const T& v2) const;
+
+	/**
+	 * @brief Find the vertices reachable from a vertex within the window
+	 *
+	 * @param v The vertex to start from
+	 * @return std::list<T> The vertices reachable from v, including v, in
+	 * breadth-first order. If vertex v does not exist, returns an empty list.
+	 */
+	std::list<T> reachable(const T& v) const;
+
+	/**
+	 * @brief Find an Euler path or circuit through the edges of the window
+	 *
+	 * @return std::list<T> The vertices along the path, or an empty list if
+	 * the edges of the window have no Euler path
+	 *
+	 * Starts at the smallest vertex of odd degree, if any, else at the
+	 * smallest vertex with an edge in the window.
+	 */
+	std::list<T> find_path() const;
+
+private:
+	const TemporalGraph* g;
+	Time t0;
+	Time t1;
+
+	bool in(const Edge& e) const { return e.end > t0; }
+};
+
+template <typename T>
+size_t TemporalGraph<T>::vertex(const T& v) {
+	auto it = index.find(v);
+	if (it != index.end())
+		return it->second;
+	index.emplace(v, names.size());
+	names.push_back(v);
+	adj.emplace_back();
+	return names.size() - 1;
+}
+
+template <typename T>
+void TemporalGraph<T>::insert(size_t i, const Edge& e) {
+	std::vector<Edge>& l = adj[i];
+	auto pos = std::upper_bound(l.begin(), l.end(), e.begin,
+		[](Time t, const Edge& x) { return t < x.begin; });
+	size_t k = pos - l.begin();
+	l.insert(pos, e);
+	Time reach = std::max(k ? l[k - 1].reach : e.end, e.end);
+	l[k].reach = reach;
+	// Carry the new end forward until an edge already reaches past it
+	while (++k < l.size() && l[k].reach < reach)
+		l[k].reach = reach;
+}
+
+template <typename T>
+void TemporalGraph<T>::add_edge(const T& v1, const T& v2, Time begin, Time end) {
+	if (end <= begin)
+		throw std::invalid_argument("TemporalGraph::add_edge: empty interval");
+	size_t i = vertex(v1), j = vertex(v2);
+	insert(i, { j, begin, end, edges, end });
+	if (i != j)
+		insert(j, { i, begin, end, edges, end });
+	edges++;
+}
+
+/**
+ * Edges overlapping [t0, t1) begin before t1 and end after t0. Every edge
+ * before the first whose reach passes t0 ends by t0, so the candidates are
+ * the run from there to the first edge beginning at or after t1; the
+ * caller still checks each edge's end against t0.
+ */
+template <typename T>
+std::pair<size_t, size_t> TemporalGraph<T>::candidates(size_t i, Time t0, Time t1) const {
+	const std::vector<Edge>& l = adj[i];
+	auto by_reach = [](const Edge& x, Time t) { return x.reach <= t; };
+	auto by_begin = [](const Edge& x, Time t) { return x.begin < t; };
+	size_t lo = std::lower_bound(l.begin(), l.end(), t0, by_reach) - l.begin();
+	size_t hi = std::lower_bound(l.begin() + lo, l.end(), t1, by_begin) - l.begin();
+	return { lo, hi };
+}
+
+template <typename T>
+size_t TemporalGraph<T>::Window::degree(const T& v) const {
+	auto it = g->index.find(v);
+	if (it == g->index.end())
+		return 0;
+	size_t d = 0;
+	auto r = g->candidates(it->second, t0, t1);
+	for (size_t k = r.first; k < r.second; k++)
+		d += in(g->adj[it->second][k]);
+	return d;
+}
+
+template <typename T>
+std::list<T> TemporalGraph<T>::Window::neighbors(const T& v) const {
+	std::list<T> l;
+	auto it = g->index.find(v);
+	if (it == g->index.end())
+		return l;
+	auto r = g->candidates(it->second, t0, t1);
+	for (size_t k = r.first; k < r.second; k++) {
+		const Edge& e = g->adj[it->second][k];
+		if (in(e))
+			l.push_back(g->names[e.to]);
+	}
+	return l;
+}
+
+template <typename T>
+bool TemporalGraph<T>::Window::is_edge(const T& v1, const T& v2) const {
+	auto it1 = g->index.find(v1), it2 = g->index.find(v2);
+	if (it1 == g->index.end() || it2 == g->index.end())
+		return false;
+	auto r = g->candidates(it1->second, t0, t1);
+	for (size_t k = r.first; k < r.second; k++) {
+		const Edge& e = g->adj[it1->second][k];
+		if (e.to == it2->second && in(e))
+			return true;
+	}
+	return false;
+}
+
+template <typename T>
+std::list<T> TemporalGraph<T>::Window::reachable(const T& v) const {
+	std::list<T> l;
+	auto it = g->index.find(v);
+	if (it == g->index.end())
+		return l;
+	std::vector<bool> seen(g->vertex_count());
+	std::vector<size_t> queue(1, it->second);
+	seen[it->second] = true;
+	for (size_t q = 0; q < queue.size(); q++) {
+		size_t i = queue[q];
+		l.push_back(g->names[i]);
+		auto r = g->candidates(i, t0, t1);
+		for (size_t k = r.first; k < r.second; k++) {
+			const Edge& e = g->adj[i][k];
+			if (in(e) && !seen[e.to]) {
+				seen[e.to] = true;
+				queue.push_back(e.to);
+			}
+		}
+	}
+	return l;
+}
+
+template <typename T>
+std::list<T> TemporalGraph<T>::Window::find_path() const {
+	std::list<T> path;
+
+	// Candidate range of each vertex, its first in-window edge being where
+	// the search resumes; degrees count loops twice here, as a trail
+	// enters and leaves by them
+	size_t n = g->vertex_count();
+	std::vector<size_t> cursor(n), stop(n);
+	size_t count_odd = 0, ends = 0;
+	size_t start = npos, first_odd = npos;
+	for (const auto& p : g->index) {
+		size_t i = p.second, d = 0;
+		auto r = g->candidates(i, t0, t1);
+		cursor[i] = r.first;
+		stop[i] = r.second;
+		for (size_t k = r.first; k < r.second; k++) {
+			const Edge& e = g->adj[i][k];
+			if (in(e))
+				d += e.to == i ? 2 : 1;
+		}
+		ends += d;
+		if (d && start == npos)
+			start = i;
+		if (d % 2) {
+			count_odd++;
+			if (first_odd == npos)
+				first_odd = i;
+		}
+	}
+	if (start == npos || (count_odd && count_odd != 2))
+		return path;
+	if (first_odd != npos)
+		start = first_odd;
+
+	// Hierholzer's algorithm, marking edges used by id
+	std::vector<bool> used(g->edges);
+	std::vector<size_t> stack(1, start);
+	std::vector<size_t> trail;
+	while (!stack.empty()) {
+		size_t i = stack.back();
+		const std::vector<Edge>& l = g->adj[i];
+		while (cursor[i] < stop[i]
+				&& (used[l[cursor[i]].id] || !in(l[cursor[i]])))
+			cursor[i]++;
+		if (cursor[i] == stop[i]) {
+			trail.push_back(i);
+			stack.pop_back();
+		} else {
+			const Edge& e = l[cursor[i]];
+			used[e.id] = true;
+			stack.push_back(e.to);
+		}
+	}
+
+	// Fewer steps than edges means the window's edges are not connected
+	if (trail.size() != ends / 2 + 1)
+		return path;
+	for (size_t k = trail.size(); k-- > 0; )
+		path.push_back(g->names[trail[k]]);
+	return path;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+
+/**
+ * @brief A single completed trace event
+ *
+ * Times are in nanoseconds relative to the creation of the trace buffer.
+ */
+struct TraceEvent {
+	const char* name;
+	uint64_t start_ns;
+	uint64_t dur_ns;
+	uint32_t tid;
+};
+
+/**
+ * @brief Fixed-size ring buffer of trace events
+ *
+ * Events are recorded with a single atomic increment and a copy into a
+ * preallocated slot, so recording never allocates. When the buffer is full
+ * the oldest events are overwritten. The buffer should only be exported once
+ * the threads recording into it are finished.
+ */
+class TraceBuffer {
+public:
+	static constexpr size_t CAPACITY = 1 << 16;
+
+	/**
+	 * @brief Get the process-wide trace buffer
+	 *
+	 * @return TraceBuffer& The shared buffer
+	 */
+	static TraceBuffer& instance() { static TraceBuffer tb; return tb; }
+
+	/**
+	 * @brief Get the current time on the trace clock
+	 *
+	 * @return uint64_t Nanoseconds since the buffer was created
+	 */
+	uint64_t now() const {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	/**
+	 * @brief Record a completed event
+	 *
+	 * @param name Name of the event, must outlive the buffer (normally a
+	 * string literal)
+	 * @param start_ns Start time as returned by now()
+	 * @param dur_ns Duration of the event
+	 */
+	void record(const char* name, uint64_t start_ns, uint64_t dur_ns) {
+		size_t i = next.fetch_add(1, std::memory_order_relaxed);
+		events[i % CAPACITY] = { name, start_ns, dur_ns, thread_id() };
+	}
+
+	/**
+	 * @brief Discard all recorded events
+	 */
+	void clear() { next.store(0, std::memory_order_relaxed); }
+
+	/**
+	 * @brief Write recorded events in Chrome trace JSON format
+	 *
+	 * @param os The output object
+	 *
+	 * The output can be loaded in chrome://tracing or ui.perfetto.dev. Each
+	 * event becomes a complete ("X") event, with one track per thread.
+	 */
+	void write_chrome_trace(std::ostream& os) const;
+
+private:
+	TraceEvent events[CAPACITY];
+	std::atomic<size_t> next{0};
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	// Chrome traces use microseconds; keep nanosecond precision as decimals
+	static std::string micros(uint64_t ns) {
+		char buf[32];
+		std::snprintf(buf, sizeof buf, "%llu.%03llu",
+			(unsigned long long) (ns / 1000), (unsigned long long) (ns % 1000));
+		return buf;
+	}
+
+	// Small sequential ids read better in trace viewers than native ids
+	static uint32_t thread_id() {
+		static std::atomic<uint32_t> counter{0};
+		thread_local uint32_t id = ++counter;
+		return id;
+	}
+};
+
+inline void TraceBuffer::write_chrome_trace(std::ostream& os) const {
+	size_t end = next.load(std::memory_order_relaxed);
+	size_t begin = end > CAPACITY ? end - CAPACITY : 0;
+	os << "{\"traceEvents\":[";
+	for (size_t i = begin; i < end; i++) {
+		const TraceEvent& e = events[i % CAPACITY];
+		os << (i == begin ? "\n" : ",\n")
+			<< "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1"
+			<< ",\"tid\":" << e.tid
+			<< ",\"ts\":" << micros(e.start_ns)
+			<< ",\"dur\":" << micros(e.dur_ns) << "}";
+	}
+	os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+/**
+ * @brief Records the lifetime of a scope as a trace event
+ */
+class ScopedTrace {
+public:
+	explicit ScopedTrace(const char* name)
+		: name(name), start(TraceBuffer::instance().now()) { }
+	~ScopedTrace() {
+		TraceBuffer& tb = TraceBuffer::instance();
+		tb.record(name, start, tb.now() - start);
+	}
+	ScopedTrace(const ScopedTrace&) = delete;
+	ScopedTrace& operator= (const ScopedTrace&) = delete;
+private:
+	const char* name;
+	uint64_t start;
+};
+
+// Tracing compiles away entirely unless EULER_TRACE is defined
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#ifdef EULER_TRACE
+#define TRACE_SCOPE(name) ScopedTrace TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) do { } while (0)
+#endif
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Buffered writer for vertex trails in text or binary form
+ *
+ * Text trails are written as vertices separated by single spaces and ended
+ * by a newline. Binary trails are written as a varint count of vertices
+ * followed by the first vertex and then the difference between each vertex
+ * and the one before it, each zigzag-encoded as a varint (LEB128), so that
+ * trails through nearby vertex numbers take one or two bytes per vertex.
+ *
+ * Output is formatted into a large buffer with std::to_chars and handed to
+ * fwrite only when the buffer fills, on flush(), or on destruction. Other
+ * output to the same FILE (including through std::cout, when synchronized
+ * with stdio) must not be interleaved without a flush().
+ */
+class TrailWriter {
+public:
+	enum class Format { Text, Binary };
+
+	/**
+	 * @brief Create a writer
+	 *
+	 * @param out Destination, which is not closed by the writer
+	 * @param format Text or binary trails
+	 * @param buffer_size Bytes buffered between writes to out
+	 */
+	explicit TrailWriter(FILE* out, Format format = Format::Text,
+		size_t buffer_size = 1 << 20)
+		: out(out), format(format), buf(buffer_size < 64 ? 64 : buffer_size) { }
+	~TrailWriter() { flush(); }
+	TrailWriter(const TrailWriter&) = delete;
+	TrailWriter& operator= (const TrailWriter&) = delete;
+
+	/**
+	 * @brief Write a whole trail
+	 *
+	 * @tparam C Container of integer vertices
+	 * @param trail The vertices along the trail
+	 */
+	template <typename C>
+	void write_trail(const C& trail);
+
+	/**
+	 * @brief Write text as-is
+	 *
+	 * @param s Null-terminated text
+	 */
+	void text(const char* s);
+
+	/**
+	 * @brief Write one vertex as decimal text
+	 *
+	 * @tparam V Integer type of vertex
+	 * @param v The vertex
+	 */
+	template <typename V>
+	void vertex(V v);
+
+	/**
+	 * @brief Write all buffered output to the destination
+	 */
+	void flush();
+
+private:
+	FILE* out;
+	Format format;
+	std::vector<char> buf;
+	size_t pos = 0;
+
+	// Make room for n more bytes
+	void reserve(size_t n) { if (pos + n > buf.size()) flush(); }
+	void varint(uint64_t x);
+	static uint64_t zigzag(int64_t x) { return ((uint64_t) x << 1) ^ (uint64_t) (x >> 63); }
+};
+
+template <typename C>
+void TrailWriter::write_trail(const C& trail) {
+	if (format == Format::Binary) {
+		varint(trail.size());
+		int64_t prev = 0;
+		for (const auto& v : trail) {
+			varint(zigzag((int64_t) v - prev));
+			prev = (int64_t) v;
+		}
+	} else {
+		bool first = true;
+		for (const auto& v : trail) {
+			if (!first)
+				text(" ");
+			vertex(v);
+			first = false;
+		}
+		text("\n");
+	}
+}
+
+inline void TrailWriter::text(const char* s) {
+	size_t n = std::strlen(s);
+	if (n > buf.size()) {
+		flush();
+		std::fwrite(s, 1, n, out);
+		return;
+	}
+	reserve(n);
+	std::memcpy(buf.data() + pos, s, n);
+	pos += n;
+}
+
+template <typename V>
+void TrailWriter::vertex(V v) {
+	static_assert(std::is_integral<V>::value, "vertices must be integers");
+	reserve(24);
+	pos = std::to_chars(buf.data() + pos, buf.data() + buf.size(), v).ptr
+		- buf.data();
+}
+
+inline void TrailWriter::varint(uint64_t x) {
+	reserve(10);
+	while (x >= 0x80) {
+		buf[pos++] = (char) (x | 0x80);
+		x >>= 7;
+	}
+	buf[pos++] = (char) x;
+}
+
+inline void TrailWriter::flush() {
+	if (pos)
+		std::fwrite(buf.data(), 1, pos, out);
+	pos = 0;
+	std::fflush(out);
+}
+
+/**
+ * @brief Read one binary trail written by TrailWriter
+ *
+ * @tparam V Integer type of vertex
+ * @param in Source of binary trails
+ * @param trail Receives the vertices along the trail
+ * @return true A trail was read
+ * @return false End of input, or the input was truncated
+ */
+template <typename V>
+bool read_binary_trail(FILE* in, std::vector<V>& trail) {
+	auto varint = [in](uint64_t& x) {
+		x = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			int c = std::fgetc(in);
+			if (c == EOF)
+				return false;
+			x |= (uint64_t) (c & 0x7f) << shift;
+			if (!(c & 0x80))
+				return true;
+		}
+		return false;
+	};
+	uint64_t n, z;
+	if (!varint(n))
+		return false;
+	trail.clear();
+	int64_t prev = 0;
+	for (uint64_t i = 0; i < n; i++) {
+		if (!varint(z))
+			return false;
+		prev += (int64_t) (z >> 1) ^ -(int64_t) (z & 1);
+		trail.push_back((V) prev);
+	}
+	return true;
+}
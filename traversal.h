@@ -0,0 +1,118 @@
+#pragma once
+
+#include "frozen_graph.h"
+#include "scheduler.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Find distances from one vertex to all others by breadth-first search
+ *
+ * @param g The graph of interest
+ * @param source Index of the starting vertex
+ * @param dist Receives the number of edges on a shortest path from source to
+ * each vertex, or FrozenGraph<T>::npos for vertices that cannot be reached
+ * @param prefetch How many queued vertices ahead to prefetch, or zero for
+ * no prefetching
+ *
+ * The adjacency of a vertex is usually far from that of the vertex before it
+ * in the queue, so each visit stalls on two dependent cache misses: its edge
+ * positions, then its targets. With prefetching, the edge positions of the
+ * vertex 2 * prefetch places ahead in the queue and the targets of the
+ * vertex prefetch places ahead are requested early, so both are cached by
+ * the time they are visited.
+ */
+template <typename T>
+void bfs(const FrozenGraph<T>& g, size_t source, std::vector<size_t>& dist,
+	size_t prefetch = 8) {
+	dist.assign(g.vertex_count(), FrozenGraph<T>::npos);
+	std::vector<size_t> queue;
+	queue.reserve(g.vertex_count());
+	queue.push_back(source);
+	dist[source] = 0;
+	for (size_t q = 0; q < queue.size(); q++) {
+		if (prefetch) {
+			if (q + 2 * prefetch < queue.size())
+				g.prefetch_offsets(queue[q + 2 * prefetch]);
+			if (q + prefetch < queue.size())
+				g.prefetch_targets(queue[q + prefetch]);
+		}
+		size_t v = queue[q];
+		for (size_t u : g.neighbors(v)) {
+			if (dist[u] == FrozenGraph<T>::npos) {
+				dist[u] = dist[v] + 1;
+				queue.push_back(u);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Run a loop in parallel over every edge of a graph
+ *
+ * @tparam F Callable as f(size_t v, size_t lo, size_t hi), processing edges
+ * lo through hi - 1, all of which leave vertex v
+ * @param g The graph of interest
+ * @param f The loop body
+ * @param grain Largest number of edges given to one task; zero picks a size
+ * that gives each worker several tasks
+ * @param s Scheduler to run on
+ *
+ * The edges, rather than the vertices, are divided evenly among tasks, and a
+ * vertex whose edges straddle a division is handed to each task in pieces.
+ * On power-law graphs, where a handful of hubs hold a large share of the
+ * edges, this keeps any one hub from serializing the loop, which splitting
+ * by vertex (even weighted by degree) cannot do. Vertices without edges are
+ * never visited.
+ */
+template <typename T, typename F>
+void parallel_for_edges(const FrozenGraph<T>& g, F f, size_t grain = 0,
+	Scheduler& s = Scheduler::instance()) {
+	parallel_for(0, g.edge_count(), [&](size_t lo, size_t hi) {
+		for (size_t v = g.edge_source(lo); lo < hi; v++) {
+			size_t end = std::min(hi, g.offset(v + 1));
+			if (lo < end)
+				f(v, lo, end);
+			lo = end;
+		}
+	}, grain, s);
+}
+
+/**
+ * @brief Run a loop in parallel over every edge of a graph
+ *
+ * @tparam F Callable as f(const T& v1, const T& v2, size_t w) for each edge
+ * from v1 to v2 with weight w
+ * @param g The graph of interest
+ * @param f The loop body, which may be called from several threads at once
+ * @param grain Largest number of edges given to one task; zero picks a size
+ * that gives each worker several tasks
+ * @param s Scheduler to run on
+ *
+ * The vertices are first listed with their edge counts in one serial pass,
+ * which allocates two words per vertex. Tasks are then split by edge count,
+ * as with parallel_for_weighted(), and each reads its vertices' adjacency
+ * directly. A vertex's edges are never split between tasks.
+ */
+template <typename T, typename F>
+void parallel_for_edges(const DiGraph<T>& g, F f, size_t grain = 0,
+	Scheduler& s = Scheduler::instance()) {
+	VertexView<T> vv = g.vertex_view();
+	std::vector<typename VertexView<T>::iterator> verts;
+	std::vector<size_t> offsets(1, 0);
+	verts.reserve(vv.size());
+	offsets.reserve(vv.size() + 1);
+	for (auto it = vv.begin(); it != vv.end(); ++it) {
+		verts.push_back(it);
+		offsets.push_back(offsets.back() + it.neighbors().size());
+	}
+	parallel_for_weighted(0, verts.size(), [&](size_t i) { return offsets[i]; },
+		[&](size_t lo, size_t hi) {
+			for (size_t i = lo; i < hi; i++) {
+				NeighborView<T> nv = verts[i].neighbors();
+				for (auto q = nv.begin(); q != nv.end(); ++q)
+					f(*verts[i], *q, q.weight());
+			}
+		}, grain, s);
+}